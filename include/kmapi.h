@@ -261,6 +261,9 @@ public:
     KMError setSslServerName(const char *server_name);
     KMError bind(const char *bind_host, uint16_t bind_port);
     KMError connect(const char *host, uint16_t port, EventCallback cb, uint32_t timeout_ms = 0);
+    /* the fd keeps its TCP_NODELAY and other socket options, e.g. the ones set by
+     * TcpListener::SocketOptions. it is made nonblocking and close-on-exec if not yet
+     */
     KMError attachFd(SOCKET_FD fd);
     KMError detachFd(SOCKET_FD &fd);
     KMError startSslHandshake(SslRole ssl_role, EventCallback cb);
@@ -269,12 +272,28 @@ public:
     int send(const iovec *iovs, int count);
     int send(const KMBuffer &buf);
     int receive(void *data, size_t length);
+    /* receive data as buf, buf refers to the receive buffer of socket without copying
+     * when the socket is completion based, e.g. io_uring
+     */
+    int receive(KMBuffer &buf);
     
     KMError close();
     
     KMError pause();
     KMError resume();
     
+    /* set the watermarks of the pending send queue, send returns 0 once the queued
+     * bytes reach high, and write callback is called when they drop to low.
+     * it only takes effect when the socket queues outgoing data, e.g. io_uring
+     */
+    KMError setSendBufferWatermarks(size_t high, size_t low);
+    /* send KMBuffer of at least threshold bytes with MSG_ZEROCOPY, the KMBuffer storage
+     * is held until the kernel completes the transmission, so the sent bytes must not
+     * be modified. only KMBuffer with shared storage over plain TCP is sent without copy.
+     * 0 to disable (default). Linux only, not supported by io_uring
+     */
+    KMError setZeroCopyThreshold(size_t threshold);
+    
     /* NOTE: cb must be valid until close called
      */
     void setReadCallback(EventCallback cb);
@@ -296,6 +315,16 @@ public:
     using AcceptCallback = std::function<bool(SOCKET_FD, const char*, uint16_t)>;
     using ErrorCallback = std::function<void(KMError)>;
     
+    /* the options applied to every accepted socket before AcceptCallback,
+     * TcpSocket::attachFd keeps them, on any thread
+     */
+    struct SocketOptions
+    {
+        bool tcp_nodelay = true; // same as the sockets created by TcpSocket
+        int recv_buffer_size = 0; // SO_RCVBUF, 0 means system default
+        int send_buffer_size = 0; // SO_SNDBUF, 0 means system default
+    };
+    
     TcpListener(EventLoop *loop);
     TcpListener(const TcpListener &) = delete;
     TcpListener(TcpListener &&other);
@@ -308,6 +337,70 @@ public:
     KMError stopListen(const char *host, uint16_t port);
     KMError close();
     
+    /* set the backlog of listen, default is 128.
+     * only take effect when called before startListen
+     */
+    KMError setBacklog(int backlog);
+    /* enable SO_REUSEPORT, so that several listeners can listen on the same address
+     * and the kernel distributes the incoming connections across them.
+     * only take effect when called before startListen
+     */
+    KMError setReusePort(bool enable);
+    /* the max number of connections accepted per wakeup, the remaining connections
+     * are accepted in next loop iteration. 0 means accepting until no more pending
+     */
+    KMError setAcceptBudget(uint32_t budget);
+    KMError setSocketOptions(const SocketOptions &opts);
+    
+    void setAcceptCallback(AcceptCallback cb);
+    void setErrorCallback(ErrorCallback cb);
+    
+    class Impl;
+    Impl* pimpl() const;
+    
+private:
+    Impl* pimpl_;
+};
+
+/* ServerRuntime runs a number of event loops in their own threads. on Linux, every loop
+ * has its own SO_REUSEPORT listener on the same address, so the kernel spreads the
+ * accepting across the loops, and the accepted fd is delivered on the loop thread that
+ * accepted it. on other platforms, where SO_REUSEPORT does not balance the connections,
+ * the first loop accepts and the fds are handed out to the loops round-robin
+ */
+class KUMA_API ServerRuntime
+{
+public:
+    /* called on the thread of loop, loop is the owner of the accepted fd
+     */
+    using AcceptCallback = std::function<bool(EventLoop *loop, SOCKET_FD, const char*, uint16_t)>;
+    using ErrorCallback = std::function<void(EventLoop *loop, KMError)>;
+    using SocketOptions = TcpListener::SocketOptions;
+    
+    ServerRuntime(PollType poll_type = PollType::DEFAULT);
+    ServerRuntime(const ServerRuntime &) = delete;
+    ~ServerRuntime();
+    
+    ServerRuntime& operator=(const ServerRuntime &) = delete;
+    
+    /* start the loops and listen on host:port
+     *
+     * @param loop_count the number of event loops, 0 means the number of CPU cores
+     */
+    KMError start(const char *host, uint16_t port, size_t loop_count = 0);
+    /* stop the listeners and the loops, must not be called on the loop threads
+     */
+    void stop();
+    
+    /* only take effect when called before start
+     */
+    KMError setBacklog(int backlog);
+    KMError setAcceptBudget(uint32_t budget);
+    KMError setSocketOptions(const SocketOptions &opts);
+    
+    size_t getLoopCount() const;
+    EventLoop* getLoop(size_t index) const;
+    
     void setAcceptCallback(AcceptCallback cb);
     void setErrorCallback(ErrorCallback cb);
     
@@ -321,6 +414,26 @@ class KUMA_API UdpSocket
 public:
     using EventCallback = std::function<void(KMError)>;
     
+    /* the datagram of batch APIs
+     */
+    struct Datagram
+    {
+        /* receiveBatch writes the datagram to the space of buf,
+         * sendBatch sends the data of buf, buf can be chained
+         */
+        KMBuffer *buf = nullptr;
+        /* the source address of received datagram, or the destination of sent datagram.
+         * they are ignored by sendBatch if the socket is connected
+         */
+        char ip[64] = {0};
+        uint16_t port = 0;
+        /* sendBatch sends buf as datagrams of segment_size with UDP GSO if it is not 0.
+         * receiveBatch sets it when buf holds several datagrams coalesced by UDP GRO,
+         * every datagram is segment_size bytes except the last one
+         */
+        uint16_t segment_size = 0;
+    };
+    
     UdpSocket(EventLoop *loop);
     UdpSocket(const UdpSocket &) = delete;
     UdpSocket(UdpSocket &&other);
@@ -334,7 +447,32 @@ public:
     int send(const void *data, size_t length, const char *host, uint16_t port);
     int send(const iovec *iovs, int count, const char *host, uint16_t port);
     int send(const KMBuffer &buf, const char *host, uint16_t port);
+    /* send buf as datagrams of segment_size with UDP GSO in one system call, the kernel
+     * or NIC splits it. at most 64 segments and 64KB in total
+     */
+    int send(const KMBuffer &buf, const char *host, uint16_t port, uint16_t segment_size);
     int receive(void *data, size_t length, char *ip_buf, size_t ip_len, uint16_t &port);
+    /* receive up to count datagrams with one system call where recvmmsg is supported,
+     * the read callback can drain the socket in batches
+     *
+     * @return the number of datagrams received, 0 if no datagram pending, < 0 on error
+     */
+    int receiveBatch(Datagram *dgrams, int count);
+    /* send up to count datagrams with one system call where sendmmsg is supported
+     *
+     * @return the number of datagrams sent, < count if the socket is blocked, < 0 on error
+     */
+    int sendBatch(const Datagram *dgrams, int count);
+    /* enable UDP GRO, the kernel may coalesce the datagrams of same flow into one buffer.
+     * use receiveBatch to get the segment size of the coalesced datagrams
+     */
+    KMError setGroEnabled(bool enable);
+    /* split the coalesced datagrams in buf into segs without copying,
+     * buf is the unchained buffer filled by receiveBatch
+     *
+     * @return the number of datagrams filled
+     */
+    static int splitSegments(const KMBuffer &buf, uint16_t segment_size, KMBuffer *segs, int count);
     
     KMError close();
     
@@ -401,6 +539,23 @@ public:
      */
     using EnumerateCallback = std::function<bool(const char*, const char*)>; // (name, value)
     
+    /* the message is rejected with HttpEvent::HTTP_ERROR once a limit is exceeded,
+     * the data buffered for it is released at once
+     */
+    struct Limits
+    {
+        size_t max_start_line = 8 * 1024;
+        size_t max_header_bytes = 64 * 1024; // start line, headers and trailers
+        size_t max_header_count = 100;
+        size_t max_chunk_extension = 1024;
+        /* the application/x-www-form-urlencoded body of request is parsed into params
+         * when max_form_bytes is not 0, it is not rejected by these limits, the form
+         * parsing just stops. the body is always delivered by data callback
+         */
+        size_t max_form_bytes = 0;
+        size_t max_form_fields = 100;
+    };
+    
     HttpParser();
     HttpParser(const HttpParser &) = delete;
     HttpParser(HttpParser &&other);
@@ -426,6 +581,12 @@ public:
     bool paused() const;
     bool isUpgradeTo(const char *protocol) const;
     
+    void setLimits(const Limits &limits);
+    /* the status code to reject the request with, 431 if the headers exceed
+     * the limits, 400 for other errors, 0 if there is no error
+     */
+    int getErrorStatus() const;
+    
     int getStatusCode() const;
     const char* getUrl() const;
     const char* getUrlPath() const;
@@ -502,6 +663,31 @@ private:
     Impl* pimpl_;
 };
 
+/* pre-serialized response header, it is built once and shared by the responses
+ * with the same header set. only Date and Content-Length are filled when sent,
+ * Content-Length is not sent for 1xx, 204 and 304
+ */
+class KUMA_API HttpHeaderTemplate
+{
+public:
+    HttpHeaderTemplate(int status_code, const char *desc = nullptr, const char *ver = "HTTP/1.1");
+    HttpHeaderTemplate(const HttpHeaderTemplate &) = delete;
+    ~HttpHeaderTemplate();
+    
+    HttpHeaderTemplate& operator=(const HttpHeaderTemplate &) = delete;
+    
+    /* Content-Length, Transfer-Encoding and Date cannot be added
+     */
+    KMError addHeader(const char *name, const char *value);
+    KMError addHeader(const char *name, uint32_t value);
+    
+    class Impl;
+    Impl* pimpl() const;
+    
+private:
+    Impl* pimpl_;
+};
+
 class KUMA_API HttpResponse
 {
 public:
@@ -528,8 +714,24 @@ public:
     KMError addHeader(const char *name, const char *value);
     KMError addHeader(const char *name, uint32_t value);
     KMError sendResponse(int status_code, const char *desc = nullptr);
+    /* send the response header from template, bypassing the header processing of
+     * sendResponse, e.g. Content-Type and compression. INVALID_STATE is returned if any
+     * header is added by addHeader. the connection is kept alive unless the request or
+     * the Connection header of template closes it, so the template should have
+     * "Connection: keep-alive" for HTTP/1.0 requests. not supported by HTTP/2
+     */
+    KMError sendResponse(const HttpHeaderTemplate &tpl, size_t content_length);
     int sendData(const void *data, size_t len);
     int sendData(const KMBuffer &buf);
+    /* allow up to high bytes buffered before sendData returns 0, write callback is
+     * called when the buffered bytes drop to low. high = 0 means sendData returns 0
+     * until all buffered data is sent (default). not supported by HTTP/2
+     */
+    KMError setSendBufferWatermarks(size_t high, size_t low);
+    /* send body of at least threshold bytes without copy, see TcpSocket::setZeroCopyThreshold.
+     * not supported by HTTP/2
+     */
+    KMError setZeroCopyThreshold(size_t threshold);
     void reset(); // reset for connection reuse
     
     KMError close();
@@ -538,6 +740,11 @@ public:
     const char* getPath() const;
     const char* getQuery() const;
     const char* getVersion() const;
+    /* the params come from the query string, and from the request body if it is
+     * application/x-www-form-urlencoded and the HttpParser it is attached with enables
+     * form parsing by Limits::max_form_bytes, the body fields are available after the
+     * request is complete
+     */
     const char* getParamValue(const char *name) const;
     const char* getHeaderValue(const char *name) const;
     void forEachHeader(const EnumerateCallback &cb) const;
@@ -611,6 +818,20 @@ public:
      */
     int send(const void *data, size_t len, bool is_text, bool is_fin=true, uint32_t flags=0);
     int send(const KMBuffer &buf, bool is_text, bool is_fin=true, uint32_t flags=0);
+    /* allow up to high bytes buffered before send returns 0, write callback is
+     * called when the buffered bytes drop to low. high = 0 means send returns 0
+     * until all buffered data is sent (default). not supported by HTTP/2
+     */
+    KMError setSendBufferWatermarks(size_t high, size_t low);
+    /* gather the small frames sent in one loop iteration and flush them with one
+     * system call at the end of the iteration. not supported by HTTP/2
+     */
+    KMError setCorkEnabled(bool enabled);
+    /* send the payload of at least threshold bytes without copy, see
+     * TcpSocket::setZeroCopyThreshold. the payload of client is masked in place.
+     * not supported by HTTP/2
+     */
+    KMError setZeroCopyThreshold(size_t threshold);
     
     KMError close();
     
@@ -666,6 +887,15 @@ public:
     bool canSendData() const;
     bool sendBufferEmpty() const;
     
+    /* send returns 0 once the buffered bytes reach high, and write callback is
+     * called when they drop to low. high = 0 means unbounded (default)
+     */
+    KMError setSendBufferWatermarks(size_t high, size_t low);
+    /* gather the small data sent in one loop iteration and flush it with one
+     * system call at the end of the iteration
+     */
+    KMError setCorkEnabled(bool enabled);
+    
     class Impl;
 private:
     Impl* pimpl_;
@@ -689,6 +919,10 @@ public:
     KMError setSslFlags(uint32_t ssl_flags);
     KMError attachFd(SOCKET_FD fd, const KMBuffer *init_buf=nullptr);
     KMError attachSocket(TcpSocket &&tcp, HttpParser &&parser, const KMBuffer *init_buf=nullptr);
+    /* gather the frames sent in one loop iteration and flush them with one
+     * system call at the end of the iteration
+     */
+    KMError setCorkEnabled(bool enabled);
     
     KMError close();
     
@@ -720,6 +954,39 @@ KUMA_API void setLogCallback(LogCallback cb);
 KUMA_API void setLogLevel(int level);
 KUMA_API int getLogLevel();
 
+struct HttpCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+    uint64_t revalidations = 0; // stored responses refreshed by 304
+    uint64_t disk_hits = 0;     // responses loaded from disk tier
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t disk_bytes = 0;
+};
+// the byte budget of the http response cache shared by HTTP/1.x and HTTP/2 requests,
+// 0 disables the cache. the responses of GET requests are cached by their Cache-Control
+// or Expires, and revalidated by ETag or Last-Modified when they are stale
+KUMA_API void setHttpCacheCapacity(size_t bytes);
+KUMA_API HttpCacheStats getHttpCacheStats();
+// store the large response bodies in memory-mapped segment files of dir, up to capacity
+// bytes, they are loaded again after restart. dir is nullptr or capacity is 0 to disable it.
+// the body is copied to disk on the event loop which receives it, large bodies block it longer
+KUMA_API KMError setHttpCacheDiskTier(const char *dir, size_t capacity);
+
+struct HttpConnectionPoolConfig
+{
+    size_t max_idle = 64;               // idle connections kept per event loop
+    size_t max_idle_per_host = 6;       // idle connections kept per origin
+    uint32_t idle_timeout_ms = 30000;   // idle connections are closed after this
+};
+// the keep-alive HTTP/1.x client connections are kept in the pool of their event loop
+// after the response completes, and reused by the requests to same origin. max_idle is 0
+// to disable the pool
+KUMA_API void setHttpConnectionPoolConfig(const HttpConnectionPoolConfig &config);
+
 KUMA_NS_END
 
 #endif
@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <atomic>
+#include "kmbufpool.h"
 
 #ifndef KUMA_OS_WIN
 #include <sys/uio.h> // for struct iovec
@@ -41,6 +42,7 @@ public:
     virtual size_t size() const = 0;
     virtual long increment() = 0;
     virtual long decrement() = 0;
+    virtual long useCount() const = 0;
 };
 
 class _SharedBasePtr final
@@ -167,6 +169,11 @@ public:
         return tmp;
     }
     
+    long useCount() const override
+    {
+        return ref_count_.load();
+    }
+    
 private:
     void* data_ = nullptr;
     size_t size_ = 0;
@@ -257,7 +264,7 @@ public:
     
     bool allocBuffer(size_t size)
     {
-        std::allocator<char> a;
+        KMBufferAllocator<char> a;
         return allocBuffer(size, a);
     }
     
@@ -357,6 +364,12 @@ public:
     void* writePtr() const { return wr_ptr_; }
 
     bool isChained() const { return next_ != this; }
+    /* the storage is reference counted, copy of this KMBuffer shares it without copying data
+     */
+    bool isShared() const { return !!shared_data_; }
+    /* the number of KMBuffer sharing the storage, 0 if the storage is not shared
+     */
+    long sharedCount() const { return shared_data_ ? shared_data_->useCount() : 0; }
 
     void bytesRead(size_t len)
     {
@@ -483,7 +496,7 @@ public:
                 KMBuffer *dd = nullptr;
                 if(!shared_data_) {
                     dd = new KMBuffer(StorageType::OTHER);
-                    std::allocator<char> a;
+                    KMBufferAllocator<char> a;
                     dd->allocBuffer(copy_len, a);
                     dd->write(static_cast<char*>(kmb->readPtr()) + offset, copy_len);
                 } else {
@@ -507,6 +520,31 @@ public:
         return dup;
     }
     
+    /**
+     * reset buf to [offset, offset+len) of this KMBuffer, the chain is not included.
+     * buf shares the storage if this KMBuffer owns shared data, otherwise buf refers
+     * to the data directly and caller should make sure data is valid
+     */
+    void sliceSelf(KMBuffer &buf, size_t offset, size_t len) const
+    {
+        buf.reset();
+        if (offset > length()) {
+            offset = length();
+        }
+        if (offset + len > length()) {
+            len = length() - offset;
+        }
+        if (shared_data_) {
+            buf.shared_data_ = shared_data_;
+            buf.begin_ptr_ = begin_ptr_;
+            buf.end_ptr_ = end_ptr_;
+            buf.rd_ptr_ = rd_ptr_ + offset;
+            buf.wr_ptr_ = buf.rd_ptr_ + len;
+        } else {
+            buf.reset(rd_ptr_ + offset, len, len);
+        }
+    }
+    
     void reclaim()
     {
         if(length() > 0) {
@@ -523,7 +561,7 @@ public:
     void coalesce()
     {
         if (isChained()) {
-            std::allocator<char> a;
+            KMBufferAllocator<char> a;
             auto size = chainLength();
             auto* sd = createSharedData(size, a);
             auto* data = sd->data();
@@ -569,7 +607,7 @@ public:
     {
         using DataDeleterType = std::decay_t<DataDeleter>;
         shared_data_.reset();
-        std::allocator<char> a;
+        KMBufferAllocator<char> a;
         auto deleter = [a](void *ptr, size_t size) mutable {
             a.deallocate((char*)ptr, size);
         };
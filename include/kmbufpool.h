@@ -0,0 +1,321 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __KMBufferPool_H__
+#define __KMBufferPool_H__
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+
+namespace kuma {
+
+//////////////////////////////////////////////////////////////////////////
+// class KMBufferPool
+/**
+ * KMBufferPool caches the storage of KMBuffer by size class, there is one pool
+ * per thread, so the event loop allocates from its own pool without locking.
+ * the storage can be released in any thread, it is returned to the pool of the
+ * thread that allocated it.
+ */
+class KMBufferPool final
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;            // allocations served by the pool
+        size_t misses = 0;          // allocations served by the system allocator
+        size_t remote_frees = 0;    // storage released by other threads
+        size_t bytes_held = 0;      // bytes cached by the pool
+    };
+
+    KMBufferPool(const KMBufferPool &) = delete;
+    KMBufferPool& operator=(const KMBufferPool &) = delete;
+
+    /**
+     * the pool of current thread
+     */
+    static KMBufferPool& threadPool()
+    {
+        static thread_local KMBufferPool pool;
+        return pool;
+    }
+
+    static void* allocateStorage(size_t size)
+    {
+        int cls = sizeClass(size);
+        if (cls < 0) {
+            return ::operator new(size);
+        }
+        if (poolDestroyed()) {
+            // the thread is exiting, the storage will not be cached
+            auto *blk = static_cast<Block*>(::operator new(sizeof(Block) + classCapacity(cls)));
+            blk->core = nullptr;
+            blk->cls = cls;
+            return blk + 1;
+        }
+        return threadPool().allocate(cls);
+    }
+
+    static void deallocateStorage(void *ptr, size_t size)
+    {
+        if (!ptr) {
+            return;
+        }
+        int cls = sizeClass(size);
+        if (cls < 0) {
+            ::operator delete(ptr);
+            return;
+        }
+        auto *blk = static_cast<Block*>(ptr) - 1;
+        auto *core = blk->core;
+        if (!core) {
+            ::operator delete(blk);
+            return;
+        }
+        auto *pool = currentPool();
+        if (pool && pool->core_ == core) {
+            pool->cache(blk);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> g(core->mutex);
+            if (core->alive) {
+                blk->next = core->remote_list;
+                core->remote_list = blk;
+                core->has_remote.store(true, std::memory_order_release);
+                return;
+            }
+        }
+        ::operator delete(blk);
+        releaseCore(core);
+    }
+
+    /**
+     * release all the storage cached by this pool
+     */
+    void trim()
+    {
+        drainRemote();
+        for (auto &fl : free_lists_) {
+            while (fl.head) {
+                auto *blk = fl.head;
+                fl.head = blk->next;
+                ::operator delete(blk);
+                releaseCore(core_);
+            }
+            fl.count = 0;
+        }
+        stats_.bytes_held = 0;
+    }
+
+    Stats getStats() const { return stats_; }
+
+private:
+    static const int kNumSizeClasses = 5; // 256B, 1KB, 4KB, 16KB, 64KB
+    // the room for the shared data header of KMBuffer
+    static const size_t kHeadroom = 256;
+    static const size_t kMaxCachedBytesPerClass = 1024*1024;
+
+    struct Block;
+    struct Core
+    {
+        std::atomic_long ref_count{1};
+        std::atomic_bool has_remote{false};
+        std::mutex mutex;
+        bool alive = true;
+        Block* remote_list = nullptr;
+    };
+    struct alignas(16) Block
+    {
+        Core* core;
+        Block* next;
+        int cls;
+    };
+    struct FreeList
+    {
+        Block* head = nullptr;
+        size_t count = 0;
+    };
+
+    KMBufferPool() : core_(new Core)
+    {
+        currentPool() = this;
+    }
+
+    ~KMBufferPool()
+    {
+        currentPool() = nullptr;
+        poolDestroyed() = true;
+        trim();
+        Block *remote_list = nullptr;
+        {
+            std::lock_guard<std::mutex> g(core_->mutex);
+            core_->alive = false;
+            remote_list = core_->remote_list;
+            core_->remote_list = nullptr;
+        }
+        while (remote_list) {
+            auto *blk = remote_list;
+            remote_list = blk->next;
+            ::operator delete(blk);
+            releaseCore(core_);
+        }
+        releaseCore(core_);
+        core_ = nullptr;
+    }
+
+    static size_t classSize(int cls)
+    {
+        return size_t(256) << (cls * 2);
+    }
+
+    static size_t classCapacity(int cls)
+    {
+        return classSize(cls) + kHeadroom;
+    }
+
+    static int sizeClass(size_t size)
+    {
+        for (int cls = 0; cls < kNumSizeClasses; ++cls) {
+            if (size <= classCapacity(cls)) {
+                return cls;
+            }
+        }
+        return -1;
+    }
+
+    static KMBufferPool*& currentPool()
+    {
+        static thread_local KMBufferPool* pool = nullptr;
+        return pool;
+    }
+
+    static bool& poolDestroyed()
+    {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    static void releaseCore(Core *core)
+    {
+        if (core->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete core;
+        }
+    }
+
+    void* allocate(int cls)
+    {
+        auto &fl = free_lists_[cls];
+        if (!fl.head && core_->has_remote.load(std::memory_order_acquire)) {
+            drainRemote();
+        }
+        auto *blk = fl.head;
+        if (blk) {
+            fl.head = blk->next;
+            --fl.count;
+            stats_.bytes_held -= classCapacity(cls);
+            ++stats_.hits;
+        } else {
+            blk = static_cast<Block*>(::operator new(sizeof(Block) + classCapacity(cls)));
+            blk->core = core_;
+            blk->cls = cls;
+            core_->ref_count.fetch_add(1, std::memory_order_relaxed);
+            ++stats_.misses;
+        }
+        blk->next = nullptr;
+        return blk + 1;
+    }
+
+    void cache(Block *blk)
+    {
+        auto cls = blk->cls;
+        auto &fl = free_lists_[cls];
+        if ((fl.count + 1) * classCapacity(cls) > kMaxCachedBytesPerClass) {
+            ::operator delete(blk);
+            releaseCore(core_);
+            return;
+        }
+        blk->next = fl.head;
+        fl.head = blk;
+        ++fl.count;
+        stats_.bytes_held += classCapacity(cls);
+    }
+
+    void drainRemote()
+    {
+        Block *remote_list = nullptr;
+        {
+            std::lock_guard<std::mutex> g(core_->mutex);
+            remote_list = core_->remote_list;
+            core_->remote_list = nullptr;
+            core_->has_remote.store(false, std::memory_order_relaxed);
+        }
+        while (remote_list) {
+            auto *blk = remote_list;
+            remote_list = blk->next;
+            ++stats_.remote_frees;
+            cache(blk);
+        }
+    }
+
+private:
+    Core* core_ = nullptr;
+    FreeList free_lists_[kNumSizeClasses];
+    Stats stats_;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// class KMBufferAllocator
+/**
+ * the default allocator of KMBuffer, the storage is allocated from the pool
+ * of current thread
+ */
+template<typename T>
+class KMBufferAllocator
+{
+public:
+    using value_type = T;
+
+    KMBufferAllocator() = default;
+    template<typename U>
+    KMBufferAllocator(const KMBufferAllocator<U> &) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(KMBufferPool::allocateStorage(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        KMBufferPool::deallocateStorage(p, n * sizeof(T));
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const KMBufferAllocator<T> &, const KMBufferAllocator<U> &) { return true; }
+template<typename T, typename U>
+bool operator!=(const KMBufferAllocator<T> &, const KMBufferAllocator<U> &) { return false; }
+
+} // namespace kuma
+
+#endif
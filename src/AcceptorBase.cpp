@@ -71,6 +71,7 @@ using namespace kuma;
 AcceptorBase::AcceptorBase(const EventLoopPtr &loop)
 : loop_(loop)
 {
+    accept_token_.eventLoop(loop);
     KM_SetObjKey("AcceptorBase");
 }
 
@@ -79,10 +80,13 @@ AcceptorBase::~AcceptorBase()
     if (!closed_) {
         AcceptorBase::close();
     }
+    accept_token_.reset();
 }
 
 void AcceptorBase::cleanup()
 {
+    accept_token_.reset();
+    accept_scheduled_ = false;
     if(INVALID_FD != fd_) {
         SOCKET_FD fd = fd_;
         fd_ = INVALID_FD;
@@ -93,7 +97,7 @@ void AcceptorBase::cleanup()
 
 KMError AcceptorBase::listen(const std::string &host, uint16_t port)
 {
-    KM_INFOXTRACE("startListen, host="<<host<<", port="<<port);
+    KM_INFOXTRACE("startListen, host="<<host<<", port="<<port<<", backlog="<<backlog_<<", reuse_port="<<reuse_port_);
     if (INVALID_FD != fd_) {
         return KMError::INVALID_STATE;
     }
@@ -119,7 +123,7 @@ KMError AcceptorBase::listen(const std::string &host, uint16_t port)
         fd_ = INVALID_FD;
         return KMError::FAILED;
     }
-    if(::listen(fd_, 128) != 0) {
+    if(::listen(fd_, backlog_) != 0) {
         KM_ERRXTRACE("startListen, failed to listen, err="<<kev::SKUtils::getLastError());
         kev::SKUtils::close(fd_);
         fd_ = INVALID_FD;
@@ -182,6 +186,23 @@ void AcceptorBase::setSocketOption()
     
     int opt_val = 1;
     setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt_val, sizeof(int));
+#ifdef SO_REUSEPORT
+    if (reuse_port_) {
+        if (setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, (char*)&opt_val, sizeof(int)) != 0) {
+            KM_WARNXTRACE("setSocketOption, failed to set SO_REUSEPORT, err="<<kev::SKUtils::getLastError());
+        }
+    }
+#endif
+}
+
+KMError AcceptorBase::setReusePort(bool enable)
+{
+#ifdef SO_REUSEPORT
+    reuse_port_ = enable;
+    return KMError::NOERR;
+#else
+    return enable ? KMError::NOT_SUPPORTED : KMError::NOERR;
+#endif
 }
 
 KMError AcceptorBase::close()
@@ -199,20 +220,59 @@ KMError AcceptorBase::close()
     return KMError::NOERR;
 }
 
+SOCKET_FD AcceptorBase::acceptFd(sockaddr_storage &peer_addr)
+{
+    socklen_t ss_len = sizeof(peer_addr);
+#if defined(KUMA_OS_LINUX)
+    // the accepted socket is nonblocking and close-on-exec already, so attachFd
+    // only checks the flags instead of setting them
+    return ::accept4(fd_, (sockaddr*)&peer_addr, &ss_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    return ::accept(fd_, (sockaddr*)&peer_addr, &ss_len);
+#endif
+}
+
+void AcceptorBase::scheduleAccept()
+{
+    auto loop = loop_.lock();
+    if (accept_scheduled_ || !loop) {
+        return;
+    }
+    accept_scheduled_ = true;
+    auto ret = loop->post([this] {
+        accept_scheduled_ = false;
+        onAccept();
+    }, &accept_token_);
+    if (ret != kev::Result::OK) {
+        accept_scheduled_ = false;
+    }
+}
+
 void AcceptorBase::onAccept()
 {
-    SOCKET_FD fd = INVALID_FD;
     auto loop = loop_.lock();
+    if (!loop) {
+        return;
+    }
+    uint32_t accepted = 0;
     sockaddr_storage ss_addr = { 0 };
     while(!closed_ && !loop->stopped()) {
-        socklen_t ss_len = sizeof(ss_addr);
-        fd = ::accept(fd_, (sockaddr*)&ss_addr, &ss_len);
+        if (accept_budget_ > 0 && accepted >= accept_budget_) {
+            // there may be more pending connections, the edge triggered poller
+            // will not notify them again, so continue in next loop iteration
+            if (!loop->isPollLT()) {
+                scheduleAccept();
+            }
+            return;
+        }
+        SOCKET_FD fd = acceptFd(ss_addr);
         if(INVALID_FD == fd) {
             if (EINTR == errno) {
                 continue;
             }
             return ;
         }
+        ++accepted;
         onAccept(fd, ss_addr);
     }
 }
@@ -228,8 +288,28 @@ void AcceptorBase::onAccept(SOCKET_FD fd)
     onAccept(fd, ss_addr);
 }
 
+void AcceptorBase::applySocketOptions(SOCKET_FD fd)
+{
+    if (sock_opts_.tcp_nodelay && kev::set_tcpnodelay(fd) != 0) {
+        KM_WARNXTRACE("applySocketOptions, failed to set TCP_NODELAY, fd=" << fd << ", err=" << kev::SKUtils::getLastError());
+    }
+    if (sock_opts_.recv_buffer_size > 0) {
+        int opt_val = sock_opts_.recv_buffer_size;
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char*)&opt_val, sizeof(opt_val)) != 0) {
+            KM_WARNXTRACE("applySocketOptions, failed to set SO_RCVBUF, fd=" << fd << ", err=" << kev::SKUtils::getLastError());
+        }
+    }
+    if (sock_opts_.send_buffer_size > 0) {
+        int opt_val = sock_opts_.send_buffer_size;
+        if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (char*)&opt_val, sizeof(opt_val)) != 0) {
+            KM_WARNXTRACE("applySocketOptions, failed to set SO_SNDBUF, fd=" << fd << ", err=" << kev::SKUtils::getLastError());
+        }
+    }
+}
+
 void AcceptorBase::onAccept(SOCKET_FD fd, sockaddr_storage &peer_addr)
 {
+    applySocketOptions(fd);
     char peer_ip[128] = { 0 };
     uint16_t peer_port = 0;
     kev::km_get_sock_addr((struct sockaddr*)&peer_addr, sizeof(peer_addr), peer_ip, sizeof(peer_ip), &peer_port);
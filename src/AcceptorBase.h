@@ -33,6 +33,7 @@ class AcceptorBase : public kev::KMObject
 public:
     using AcceptCallback = TcpListener::AcceptCallback;
     using ErrorCallback = TcpListener::ErrorCallback;
+    using SocketOptions = TcpListener::SocketOptions;
     
     AcceptorBase(const EventLoopPtr &loop);
     AcceptorBase(const AcceptorBase&) = delete;
@@ -45,6 +46,13 @@ public:
     virtual KMError listen(const std::string &host, uint16_t port);
     virtual KMError close();
     
+    /* only the options set before listen will take effect
+     */
+    void setBacklog(int backlog) { backlog_ = backlog > 0 ? backlog : kDefaultBacklog; }
+    KMError setReusePort(bool enable);
+    void setAcceptBudget(uint32_t budget) { accept_budget_ = budget; }
+    void setSocketOptions(const SocketOptions &opts) { sock_opts_ = opts; }
+    
     void setAcceptCallback(AcceptCallback cb) { accept_cb_ = std::move(cb); }
     void setErrorCallback(ErrorCallback cb) { error_cb_ = std::move(cb); }
     
@@ -57,6 +65,9 @@ protected:
 
 protected:
     void setSocketOption();
+    void applySocketOptions(SOCKET_FD fd);
+    SOCKET_FD acceptFd(sockaddr_storage &peer_addr);
+    void scheduleAccept();
     virtual void onAccept();
     void onAccept(SOCKET_FD fd);
     void onAccept(SOCKET_FD fd, sockaddr_storage &peer_addr);
@@ -65,11 +76,19 @@ protected:
     virtual void ioReady(KMEvent events, void* ol, size_t io_size);
     
 protected:
+    static const int    kDefaultBacklog = 128;
+    
     SOCKET_FD           fd_{ INVALID_FD };
     EventLoopWeakPtr    loop_;
     bool                registered_{ false };
     uint32_t            flags_{ 0 };
     bool                closed_{ true };
+    int                 backlog_{ kDefaultBacklog };
+    bool                reuse_port_{ false };
+    uint32_t            accept_budget_{ 0 };
+    bool                accept_scheduled_{ false };
+    SocketOptions       sock_opts_;
+    EventLoopToken      accept_token_;
 #ifdef KUMA_OS_WIN
     ADDRESS_FAMILY
 #else
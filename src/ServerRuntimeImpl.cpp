@@ -0,0 +1,239 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "kmconf.h"
+
+#if defined(KUMA_OS_WIN)
+# include <Ws2tcpip.h>
+# include <windows.h>
+#else
+# include <sys/types.h>
+# include <sys/socket.h>
+#endif
+
+#include <algorithm>
+#include <future>
+
+#include "ServerRuntimeImpl.h"
+#include "EventLoopImpl.h"
+#include "TcpListenerImpl.h"
+#include "libkev/src/utils/kmtrace.h"
+#include "libkev/src/utils/skutils.h"
+
+using namespace kuma;
+
+ServerRuntime::Impl::Impl(PollType poll_type)
+: poll_type_(poll_type)
+{
+    
+}
+
+ServerRuntime::Impl::~Impl()
+{
+    stop();
+}
+
+KMError ServerRuntime::Impl::setBacklog(int backlog)
+{
+    if (!loops_.empty()) {
+        return KMError::INVALID_STATE;
+    }
+    backlog_ = backlog;
+    return KMError::NOERR;
+}
+
+KMError ServerRuntime::Impl::setAcceptBudget(uint32_t budget)
+{
+    if (!loops_.empty()) {
+        return KMError::INVALID_STATE;
+    }
+    accept_budget_ = budget;
+    return KMError::NOERR;
+}
+
+KMError ServerRuntime::Impl::setSocketOptions(const SocketOptions &opts)
+{
+    if (!loops_.empty()) {
+        return KMError::INVALID_STATE;
+    }
+    sock_opts_ = opts;
+    return KMError::NOERR;
+}
+
+EventLoop* ServerRuntime::Impl::getLoop(size_t index) const
+{
+    return index < loops_.size() ? &loops_[index]->loop : nullptr;
+}
+
+KMError ServerRuntime::Impl::start(const std::string &host, uint16_t port, size_t loop_count)
+{
+    if (!loops_.empty()) {
+        return KMError::INVALID_STATE;
+    }
+    if (loop_count == 0) {
+        loop_count = std::thread::hardware_concurrency();
+        if (loop_count == 0) {
+            loop_count = 1;
+        }
+    }
+    // SO_REUSEPORT balances the TCP connections across the listeners only on Linux,
+    // other platforms deliver all of them to one listener
+#if defined(KUMA_OS_LINUX) && defined(SO_REUSEPORT)
+    sharded_ = true;
+#else
+    sharded_ = false;
+#endif
+    KM_INFOTRACE("ServerRuntime::start, host="<<host<<", port="<<port<<", loops="<<loop_count<<", sharded="<<sharded_);
+    for (size_t i = 0; i < loop_count; ++i) {
+        loops_.emplace_back(new LoopContext(poll_type_));
+    }
+    next_loop_ = 0;
+    
+    // the loops are not changed after start. when sharded, the first loop starts at first,
+    // the port it binds is used by others, so port 0 makes all the listeners on one port.
+    // otherwise the first loop, which is the only listener, starts at last, so dispatch
+    // never sees a loop not running
+    uint16_t listen_port = port;
+    for (size_t k = 0; k < loop_count; ++k) {
+        auto i = sharded_ ? k : loop_count - 1 - k;
+        auto *ctx = loops_[i].get();
+        bool need_listen = sharded_ || i == 0;
+        std::promise<KMError> result;
+        auto future = result.get_future();
+        ctx->thread = std::thread([this, ctx, need_listen, host, &listen_port, &result] {
+            auto err = KMError::FAILED;
+            if (ctx->loop.init()) {
+                err = need_listen ? startListen(*ctx, host, listen_port, sharded_) : KMError::NOERR;
+            }
+            result.set_value(err);
+            if (err == KMError::NOERR) {
+                ctx->loop.loop();
+            }
+            ctx->listener.reset();
+        });
+        auto err = future.get();
+        if (err != KMError::NOERR) {
+            KM_ERRTRACE("ServerRuntime::start, failed to start loop " << i << ", err=" << int(err));
+            stop();
+            return err;
+        }
+    }
+    return KMError::NOERR;
+}
+
+void ServerRuntime::Impl::stop()
+{
+    // stop the first loop at first, it may dispatch fds to others when not sharded
+    for (auto &ctx : loops_) {
+        auto *c = ctx.get();
+        if (c->thread.joinable()) {
+            c->loop.async([c] {
+                c->listener.reset();
+                c->loop.stop();
+            });
+            try {
+                c->thread.join();
+            } catch (std::exception &) {
+                
+            }
+        }
+        // the fds dispatched after the loop stopped are never delivered
+        std::lock_guard<std::mutex> g(c->pending_mutex);
+        for (auto fd : c->pending_fds) {
+            kev::SKUtils::close(fd);
+        }
+        c->pending_fds.clear();
+    }
+    loops_.clear();
+}
+
+KMError ServerRuntime::Impl::startListen(LoopContext &ctx, const std::string &host, uint16_t &port, bool reuse_port)
+{
+    ctx.listener.reset(new TcpListener(&ctx.loop));
+    if (backlog_ > 0) {
+        ctx.listener->setBacklog(backlog_);
+    }
+    ctx.listener->setAcceptBudget(accept_budget_);
+    ctx.listener->setSocketOptions(sock_opts_);
+    if (reuse_port) {
+        auto ret = ctx.listener->setReusePort(true);
+        if (ret != KMError::NOERR) {
+            return ret;
+        }
+    }
+    auto *c = &ctx;
+    ctx.listener->setAcceptCallback([this, c] (SOCKET_FD fd, const char *ip, uint16_t port) {
+        return onAccept(*c, fd, ip, port);
+    });
+    ctx.listener->setErrorCallback([this, c] (KMError err) {
+        if (error_cb_) {
+            error_cb_(&c->loop, err);
+        }
+    });
+    auto ret = ctx.listener->startListen(host.c_str(), port);
+    if (ret == KMError::NOERR && port == 0) {
+        port = ctx.listener->pimpl()->getLocalPort();
+    }
+    return ret;
+}
+
+bool ServerRuntime::Impl::onAccept(LoopContext &ctx, SOCKET_FD fd, const char *ip, uint16_t port)
+{
+    if (!sharded_ && loops_.size() > 1) {
+        auto index = next_loop_++ % loops_.size();
+        if (index != 0) {
+            dispatch(index, fd, ip, port);
+            return true;
+        }
+    }
+    return accept_cb_ && accept_cb_(&ctx.loop, fd, ip, port);
+}
+
+void ServerRuntime::Impl::dispatch(size_t index, SOCKET_FD fd, const std::string &ip, uint16_t port)
+{
+    auto *c = loops_[index].get();
+    {
+        std::lock_guard<std::mutex> g(c->pending_mutex);
+        c->pending_fds.push_back(fd);
+    }
+    auto ret = c->loop.post([this, c, fd, ip, port] {
+        if (!takePendingFd(*c, fd)) {
+            return; // closed by stop
+        }
+        if (!accept_cb_ || !accept_cb_(&c->loop, fd, ip.c_str(), port)) {
+            kev::SKUtils::close(fd);
+        }
+    });
+    if (ret != KMError::NOERR && takePendingFd(*c, fd)) {
+        kev::SKUtils::close(fd);
+    }
+}
+
+bool ServerRuntime::Impl::takePendingFd(LoopContext &ctx, SOCKET_FD fd)
+{
+    std::lock_guard<std::mutex> g(ctx.pending_mutex);
+    auto it = std::find(ctx.pending_fds.begin(), ctx.pending_fds.end(), fd);
+    if (it == ctx.pending_fds.end()) {
+        return false;
+    }
+    ctx.pending_fds.erase(it);
+    return true;
+}
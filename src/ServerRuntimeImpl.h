@@ -0,0 +1,93 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __ServerRuntimeImpl_H__
+#define __ServerRuntimeImpl_H__
+
+#include "kmdefs.h"
+#include "kmapi.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+KUMA_NS_BEGIN
+
+class ServerRuntime::Impl
+{
+public:
+    using AcceptCallback = ServerRuntime::AcceptCallback;
+    using ErrorCallback = ServerRuntime::ErrorCallback;
+    using SocketOptions = ServerRuntime::SocketOptions;
+    
+    Impl(PollType poll_type);
+    ~Impl();
+    
+    KMError start(const std::string &host, uint16_t port, size_t loop_count);
+    void stop();
+    
+    KMError setBacklog(int backlog);
+    KMError setAcceptBudget(uint32_t budget);
+    KMError setSocketOptions(const SocketOptions &opts);
+    
+    size_t getLoopCount() const { return loops_.size(); }
+    EventLoop* getLoop(size_t index) const;
+    
+    void setAcceptCallback(AcceptCallback cb) { accept_cb_ = std::move(cb); }
+    void setErrorCallback(ErrorCallback cb) { error_cb_ = std::move(cb); }
+    
+private:
+    struct LoopContext
+    {
+        LoopContext(PollType poll_type) : loop(poll_type) {}
+        
+        EventLoop                       loop;
+        std::unique_ptr<TcpListener>    listener;
+        std::thread                     thread;
+        // the fds dispatched to this loop and not delivered yet
+        std::mutex                      pending_mutex;
+        std::vector<SOCKET_FD>          pending_fds;
+    };
+    using LoopContextPtr = std::unique_ptr<LoopContext>;
+    
+    KMError startListen(LoopContext &ctx, const std::string &host, uint16_t &port, bool reuse_port);
+    bool takePendingFd(LoopContext &ctx, SOCKET_FD fd);
+    bool onAccept(LoopContext &ctx, SOCKET_FD fd, const char *ip, uint16_t port);
+    void dispatch(size_t index, SOCKET_FD fd, const std::string &ip, uint16_t port);
+    
+private:
+    PollType                    poll_type_;
+    int                         backlog_{ 0 };
+    uint32_t                    accept_budget_{ 0 };
+    SocketOptions               sock_opts_;
+    bool                        sharded_{ false };
+    std::vector<LoopContextPtr> loops_;
+    std::atomic<size_t>         next_loop_{ 0 };
+    
+    AcceptCallback              accept_cb_;
+    ErrorCallback               error_cb_;
+};
+
+KUMA_NS_END
+
+#endif
@@ -25,6 +25,8 @@
 #include "libkev/src/utils/skutils.h"
 #include "utils/utils.h"
 
+#include <algorithm>
+
 #if defined(KUMA_OS_WIN)
 # include <Ws2tcpip.h>
 # include <windows.h>
@@ -42,6 +44,7 @@
 # include <arpa/inet.h>
 # include <netinet/tcp.h>
 # include <netinet/in.h>
+# include <linux/errqueue.h>
 # ifdef KUMA_OS_ANDROID
 #  include <sys/uio.h>
 # endif
@@ -64,6 +67,21 @@
 # error "UNSUPPORTED OS"
 #endif
 
+#if defined(KUMA_OS_LINUX)
+# ifndef SO_ZEROCOPY
+#  define SO_ZEROCOPY 60
+# endif
+# ifndef MSG_ZEROCOPY
+#  define MSG_ZEROCOPY 0x4000000
+# endif
+# ifndef SO_EE_ORIGIN_ZEROCOPY
+#  define SO_EE_ORIGIN_ZEROCOPY 5
+# endif
+# ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#  define SO_EE_CODE_ZEROCOPY_COPIED 1
+# endif
+#endif
+
 using namespace kuma;
 
 KUMA_NS_BEGIN
@@ -95,8 +113,13 @@ void SocketBase::cleanup()
         SOCKET_FD fd = fd_;
         fd_ = INVALID_FD;
         shutdown(fd, 2);
-        unregisterFd(fd, true);
+        // the queued data is still transmitted from the pages of pending zero copy
+        // sends after shutdown, they cannot be released before the completions
+        if (zc_pending_.empty() || !lingerZeroCopy(fd)) {
+            unregisterFd(fd, true);
+        }
     }
+    zc_pending_.clear();
 }
 
 SOCKET_FD SocketBase::createFd(int addr_family)
@@ -241,7 +264,7 @@ KMError SocketBase::attachFd(SOCKET_FD fd)
     KM_INFOXTRACE("attachFd, fd=" << fd << ", state=" << (int)getState());
 
     fd_ = fd;
-    setSocketOption();
+    setSocketOption(true);
     setState(State::OPEN);
     if (!registerFd(fd_)) {
         KM_ERRXTRACE("attachFd, failed to register fd");
@@ -386,13 +409,29 @@ int SocketBase::send(const KMBuffer &buf)
     if (count <= 0) {
         return 0;
     }
-    auto ret = send(p_iovs, count);
+    int ret = 0;
+    if (canSendZeroCopy(buf)) {
+        ret = sendZeroCopy(p_iovs, count, buf);
+    } else {
+        ret = send(p_iovs, count);
+    }
     if (p_iovs != iovs) {
         delete[] p_iovs;
     }
     return ret;
 }
 
+int SocketBase::receive(KMBuffer &chunk, KMBuffer &buf)
+{
+    auto ret = receive(chunk.writePtr(), chunk.space());
+    if (ret > 0) {
+        chunk.bytesWritten(ret);
+        chunk.sliceSelf(buf, chunk.length() - ret, ret);
+        chunk.bytesRead(chunk.length());
+    }
+    return ret;
+}
+
 int SocketBase::receive(void *data, size_t length)
 {
     if (!isReady()) {
@@ -464,28 +503,54 @@ KMError SocketBase::resume()
     return KMError::INVALID_STATE;
 }
 
-void SocketBase::setSocketOption()
+void SocketBase::setSocketOption(bool attached)
 {
     if (INVALID_FD == fd_) {
         return;
     }
 
 #ifdef KUMA_OS_LINUX
-    fcntl(fd_, F_SETFD, FD_CLOEXEC);
-#endif
-
+    if (attached) {
+        // the fd accepted by accept4 is close-on-exec and nonblocking already,
+        // only the missing flags are set
+        int fd_flags = fcntl(fd_, F_GETFD);
+        if (fd_flags == -1 || !(fd_flags & FD_CLOEXEC)) {
+            fcntl(fd_, F_SETFD, FD_CLOEXEC);
+        }
+        int fl_flags = fcntl(fd_, F_GETFL);
+        if (fl_flags == -1 || !(fl_flags & O_NONBLOCK)) {
+            kev::set_nonblocking(fd_);
+        }
+    } else {
+        fcntl(fd_, F_SETFD, FD_CLOEXEC);
+        kev::set_nonblocking(fd_);
+    }
+#else
     // nonblock
     kev::set_nonblocking(fd_);
+#endif
 
     if (0) {
         int opt_val = 1;
         setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt_val, sizeof(int));
     }
 
-    if (kev::set_tcpnodelay(fd_) != 0) {
+    // the attached socket keeps its TCP_NODELAY, e.g. the one set by
+    // TcpListener::SocketOptions on the accepted socket
+    if (!attached && kev::set_tcpnodelay(fd_) != 0) {
         KM_WARNXTRACE("setSocketOption, failed to set TCP_NODELAY, fd=" << fd_ << ", err=" << kev::SKUtils::getLastError());
     }
     
+#if defined(KUMA_OS_LINUX)
+    if (zc_threshold_ > 0) {
+        int opt_val = 1;
+        if (setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &opt_val, sizeof(opt_val)) != 0) {
+            KM_WARNXTRACE("setSocketOption, failed to set SO_ZEROCOPY, fd=" << fd_ << ", err=" << kev::SKUtils::getLastError());
+            zc_threshold_ = 0;
+        }
+    }
+#endif
+    
 #ifdef KUMA_OS_MAC
     // ignore SIGPIPE
     int opt_val = 1;
@@ -495,6 +560,221 @@ void SocketBase::setSocketOption()
 #endif
 }
 
+KMError SocketBase::setZeroCopyThreshold(size_t threshold)
+{
+#if defined(KUMA_OS_LINUX)
+    if (threshold > 0 && fd_ != INVALID_FD) {
+        int opt_val = 1;
+        if (setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &opt_val, sizeof(opt_val)) != 0) {
+            KM_WARNXTRACE("setZeroCopyThreshold, failed to set SO_ZEROCOPY, err=" << kev::SKUtils::getLastError());
+            return KMError::NOT_SUPPORTED;
+        }
+    }
+    zc_threshold_ = threshold;
+    return KMError::NOERR;
+#else
+    return threshold > 0 ? KMError::NOT_SUPPORTED : KMError::NOERR;
+#endif
+}
+
+bool SocketBase::canSendZeroCopy(const KMBuffer &buf) const
+{
+    if (zc_threshold_ == 0) {
+        return false;
+    }
+    size_t chain_len = 0;
+    for (auto it = buf.begin(); it != buf.end(); ++it) {
+        if (it->length() > 0 && !it->isShared()) {
+            // the storage cannot be held without copying
+            return false;
+        }
+        chain_len += it->length();
+    }
+    return chain_len >= zc_threshold_;
+}
+
+int SocketBase::sendZeroCopy(const iovec *iovs, int count, const KMBuffer &buf)
+{
+#if defined(KUMA_OS_LINUX)
+    if (!isReady()) {
+        KM_WARNXTRACE("sendZeroCopy, invalid state=" << (int)getState());
+        return 0;
+    }
+    size_t bytes_total = 0;
+    for (int i = 0; i < count; ++i) {
+        bytes_total += iovs[i].iov_len;
+    }
+    
+    msghdr msg = { 0 };
+    msg.msg_iov = const_cast<iovec*>(iovs);
+    msg.msg_iovlen = count;
+    auto ret = ::sendmsg(fd_, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    if (0 == ret) {
+        KM_WARNXTRACE("sendZeroCopy, peer closed");
+        ret = -1;
+    } else if (ret < 0) {
+        auto err = kev::SKUtils::getLastError();
+        if (EAGAIN == err || EWOULDBLOCK == err) {
+            ret = 0;
+        } else if (ENOBUFS == err) {
+            // exceeds the locked memory limit, send it with copy
+            return send(iovs, count);
+        } else {
+            KM_ERRXTRACE("sendZeroCopy, fail, err=" << err);
+        }
+    } else {
+        // every successful call gets a sequence number from the kernel
+        zc_pending_.push_back({ zc_next_seq_++, buf });
+    }
+    
+    if (ret >= 0 && static_cast<size_t>(ret) < bytes_total) {
+        notifySendBlocked();
+    } else if (ret < 0) {
+        cleanup();
+        setState(State::CLOSED);
+    }
+    return static_cast<int>(ret);
+#else
+    return send(iovs, count);
+#endif
+}
+
+void SocketBase::onZeroCopyCompleted()
+{
+    if (drainZeroCopyCompletions(fd_, zc_pending_)) {
+        // the kernel fell back to copy, e.g. loopback, zero copy only adds cost
+        KM_INFOXTRACE("onZeroCopyCompleted, data was copied, disable zero copy");
+        zc_threshold_ = 0;
+    }
+}
+
+bool SocketBase::drainZeroCopyCompletions(SOCKET_FD fd, ZeroCopySendQueue &pending)
+{
+    bool copied = false;
+#if defined(KUMA_OS_LINUX)
+    char control[128];
+    while (!pending.empty()) {
+        msghdr msg = { 0 };
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0) {
+            break;
+        }
+        for (auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            auto *serr = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cmsg));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // the sends in range [ee_info, ee_data] are completed
+            uint32_t lo = serr->ee_info;
+            uint32_t hi = serr->ee_data;
+            auto it = std::remove_if(pending.begin(), pending.end(), [lo, hi] (const ZeroCopySend &zc) {
+                return static_cast<int32_t>(zc.seq - lo) >= 0 && static_cast<int32_t>(hi - zc.seq) >= 0;
+            });
+            pending.erase(it, pending.end());
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                copied = true;
+            }
+        }
+    }
+#endif
+    return copied;
+}
+
+class SocketBase::ZeroCopyLinger
+{
+public:
+    ZeroCopyLinger(const EventLoopPtr &loop, SOCKET_FD fd, ZeroCopySendQueue &&pending)
+    : loop_(loop), fd_(fd), pending_(std::move(pending))
+    {
+        token_.eventLoop(loop);
+    }
+    
+    bool start()
+    {
+        auto loop = loop_.lock();
+        if (!loop || loop->stopped()) {
+            return false;
+        }
+        auto cb = [this](SOCKET_FD, KMEvent ev, void*, size_t) {
+            onEvent(ev);
+        };
+        if (loop->registerFd(fd_, kEventError, std::move(cb)) != kev::Result::OK) {
+            return false;
+        }
+        // the kernel cannot complete the sends after loop exit
+        loop->appendObserver([this] (kev::LoopActivity acti) {
+            if (acti == kev::LoopActivity::EXIT) {
+                finish();
+            }
+        }, &token_);
+        // the completions may be queued before registration
+        onEvent(kEventError);
+        return true;
+    }
+    
+private:
+    void onEvent(KMEvent ev)
+    {
+        if (fd_ == INVALID_FD) {
+            return;
+        }
+        // the completions are reported even if the connection is reset
+        drainZeroCopyCompletions(fd_, pending_);
+        if (pending_.empty()) {
+            finish();
+        }
+    }
+    
+    void finish()
+    {
+        if (fd_ == INVALID_FD) {
+            return;
+        }
+        KM_INFOTRACE("ZeroCopyLinger::finish, fd=" << fd_ << ", pending=" << pending_.size());
+        auto fd = fd_;
+        fd_ = INVALID_FD;
+        token_.reset();
+        auto loop = loop_.lock();
+        if (loop) {
+            loop->unregisterFd(fd, true);
+        } else {
+            kev::SKUtils::close(fd);
+        }
+        pending_.clear();
+        // the callback of fd is being executed
+        if (!loop || loop->post([this] { delete this; }) != kev::Result::OK) {
+            delete this;
+        }
+    }
+    
+    EventLoopWeakPtr    loop_;
+    EventLoopToken      token_;
+    SOCKET_FD           fd_;
+    ZeroCopySendQueue   pending_;
+};
+
+bool SocketBase::lingerZeroCopy(SOCKET_FD fd)
+{
+    auto loop = loop_.lock();
+    if (!loop) {
+        return false;
+    }
+    unregisterFd(fd, false);
+    KM_INFOXTRACE("lingerZeroCopy, fd=" << fd << ", pending=" << zc_pending_.size());
+    auto *linger = new ZeroCopyLinger(loop, fd, std::move(zc_pending_));
+    if (!linger->start()) {
+        // the loop is stopped, nothing can be waited for
+        delete linger;
+        kev::SKUtils::close(fd);
+    }
+    return true;
+}
+
 void SocketBase::notifySendBlocked()
 {
     auto loop = loop_.lock();
@@ -588,6 +868,15 @@ void SocketBase::ioReady(KMEvent events, void *ol, size_t io_size)
             onReceive(KMError::NOERR);
             DESTROY_DETECTOR_CHECK_VOID()
         }
+        if ((events & kEventError) && getState() == State::OPEN && !zc_pending_.empty()) {
+            // completions of zero copy send are reported via error queue
+            onZeroCopyCompleted();
+            int sock_err = 0;
+            socklen_t len = sizeof(sock_err);
+            if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, (char*)&sock_err, &len) == 0 && sock_err == 0) {
+                events &= ~kEventError;
+            }
+        }
         if ((events & kEventError) && getState() == State::OPEN) {
             KM_ERRXTRACE("ioReady, kEventError on OPEN, events=" << events << ", err=" << kev::SKUtils::getLastError());
             onClose(KMError::POLL_ERROR);
@@ -27,12 +27,18 @@
 #include "DnsResolver.h"
 #include "libkev/src/utils/kmobject.h"
 #include "libkev/src/utils/DestroyDetector.h"
+
+#include <deque>
+
 KUMA_NS_BEGIN
 
 class SocketBase : public kev::KMObject, public kev::DestroyDetector
 {
 public:
     using EventCallback = std::function<void(KMError)>;
+    
+    // the size of buffer allocated to receive data into when none is provided
+    static const size_t kRecvChunkSize = 16 * 1024;
 
     SocketBase(const EventLoopPtr &loop);
     SocketBase(const SocketBase&) = delete;
@@ -50,11 +56,29 @@ public:
     virtual int send(const iovec *iovs, int count);
     virtual int send(const KMBuffer &buf);
     virtual int receive(void *data, size_t length);
+    /* receive data as buf without copying, buf shares the storage with chunk or with the
+     * buffer of socket. the data is read into the space of chunk and consumed from it,
+     * unless the socket already holds the received data, e.g. completion based I/O
+     */
+    virtual int receive(KMBuffer &chunk, KMBuffer &buf);
+    /* true if receive(chunk, buf) always hands over the buffer of socket and never
+     * uses chunk
+     */
+    virtual bool ownsRecvBuffer() const { return false; }
     virtual KMError pause();
     virtual KMError resume();
     virtual KMError close();
 
     virtual void notifySendBlocked();
+    /* the data is not buffered by SocketBase, the watermarks only take effect
+     * on sockets that queue the outgoing data, e.g. OpSocket
+     */
+    virtual KMError setSendBufferWatermarks(size_t high, size_t low) { return KMError::NOERR; }
+    /* send KMBuffer with MSG_ZEROCOPY when its length reaches threshold and all its
+     * storage is shared, the storage is held until the kernel completes the transmission,
+     * so the sent bytes must not be modified afterwards. 0 to disable
+     */
+    virtual KMError setZeroCopyThreshold(size_t threshold);
     SOCKET_FD getFd() const { return fd_; }
     EventLoopPtr eventLoop() const { return loop_.lock(); }
     bool isReady() const { return getState() == State::OPEN; }
@@ -78,7 +102,7 @@ protected:
     };
     State getState() const { return state_; }
     void setState(State state) { state_ = state; }
-    void setSocketOption();
+    void setSocketOption(bool attached = false);
     KMError connect_i(const std::string &addr, uint16_t port, uint32_t timeout_ms);
     virtual KMError connect_i(const sockaddr_storage &ss_addr, uint32_t timeout_ms);
     void cleanup();
@@ -86,6 +110,9 @@ protected:
     virtual void unregisterFd(SOCKET_FD fd, bool close_fd);
     virtual SOCKET_FD createFd(int addr_family);
     virtual void notifySendReady();
+    bool canSendZeroCopy(const KMBuffer &buf) const;
+    int sendZeroCopy(const iovec *iovs, int count, const KMBuffer &buf);
+    void onZeroCopyCompleted();
 
 protected:
     void onResolved(KMError err, const sockaddr_storage &addr);
@@ -109,6 +136,23 @@ protected:
     EventCallback       error_cb_;
 
     std::unique_ptr<Timer::Impl> timer_;
+
+    struct ZeroCopySend
+    {
+        uint32_t    seq;
+        KMBuffer    buf;
+    };
+    using ZeroCopySendQueue = std::deque<ZeroCopySend>;
+    /* the closed socket with pending zero copy sends, it holds the fd and the
+     * storage until the kernel reports all the completions
+     */
+    class ZeroCopyLinger;
+    // return true if the kernel copied the data
+    static bool drainZeroCopyCompletions(SOCKET_FD fd, ZeroCopySendQueue &pending);
+    bool lingerZeroCopy(SOCKET_FD fd);
+    size_t              zc_threshold_{ 0 };
+    uint32_t            zc_next_seq_{ 0 };
+    ZeroCopySendQueue   zc_pending_;
 };
 
 KUMA_NS_END
@@ -26,10 +26,20 @@
 
 using namespace kuma;
 
+namespace {
+    const size_t kRecvBufferSize = 64*1024;
+    // allocate a new receive buffer when the free space is less than this
+    const size_t kMinRecvBufferSpace = 4*1024;
+    const size_t kCorkBufferSize = 64*1024;
+    // data larger than this is sent directly instead of being gathered
+    const size_t kMaxCorkDataSize = 16*1024;
+}
+
 //////////////////////////////////////////////////////////////////////////
 TcpConnection::TcpConnection(const EventLoopPtr &loop)
 : tcp_(loop)
 {
+    cork_token_.eventLoop(loop);
     tcp_.setReadCallback([this] (KMError err) { onReceive(err); });
     tcp_.setWriteCallback([this] (KMError err) { onSend(err); });
     tcp_.setErrorCallback([this] (KMError err) { onClose(err); });
@@ -37,12 +47,15 @@ TcpConnection::TcpConnection(const EventLoopPtr &loop)
 
 TcpConnection::~TcpConnection()
 {
+    cork_token_.reset();
     send_buffer_.reset();
 }
 
 void TcpConnection::cleanup()
 {
     tcp_.close();
+    recv_buf_.reset();
+    cork_buffer_.reset();
 }
 
 KMError TcpConnection::connect(const std::string &host, uint16_t port, EventCallback cb)
@@ -79,8 +92,33 @@ KMError TcpConnection::attachSocket(TcpSocket::Impl &&tcp, const KMBuffer *init_
     return tcp_.attach(std::move(tcp));
 }
 
+KMError TcpConnection::reuseSocket(TcpSocket::Impl &&tcp)
+{
+    isServer_ = false;
+    initData_.clear();
+    
+    return tcp_.attach(std::move(tcp));
+}
+
+KMError TcpConnection::detachSocket(TcpSocket::Impl &tcp)
+{
+    if (flushCorkBuffer() != KMError::NOERR || !sendBufferEmpty() || !tcp_.isReady()) {
+        return KMError::INVALID_STATE;
+    }
+    return tcp.attach(std::move(tcp_));
+}
+
 int TcpConnection::send(const void *data, size_t len)
 {
+    if (cork_enabled_) {
+        auto err = reserveCorkBuffer(len);
+        if (err == KMError::NOERR) {
+            cork_buffer_.write(data, len);
+            return int(len);
+        } else if (err != KMError::AGAIN) {
+            return -1;
+        }
+    }
     if(!sendBufferEmpty()) {
         // try to send buffered data
         auto ret = sendBufferedData();
@@ -105,6 +143,21 @@ int TcpConnection::send(const void *data, size_t len)
 
 int TcpConnection::send(const iovec *iovs, int count)
 {
+    if (cork_enabled_) {
+        size_t total_len = 0;
+        for (int i=0; i<count; ++i) {
+            total_len += iovs[i].iov_len;
+        }
+        auto err = reserveCorkBuffer(total_len);
+        if (err == KMError::NOERR) {
+            for (int i=0; i<count; ++i) {
+                cork_buffer_.write(iovs[i].iov_base, iovs[i].iov_len);
+            }
+            return int(total_len);
+        } else if (err != KMError::AGAIN) {
+            return -1;
+        }
+    }
     if(!sendBufferEmpty()) {
         // try to send buffered data
         auto ret = sendBufferedData();
@@ -142,6 +195,18 @@ int TcpConnection::send(const iovec *iovs, int count)
 
 int TcpConnection::send(const KMBuffer &buf)
 {
+    if (cork_enabled_) {
+        auto chain_len = buf.chainLength();
+        auto err = reserveCorkBuffer(chain_len);
+        if (err == KMError::NOERR) {
+            for (auto it = buf.begin(); it != buf.end(); ++it) {
+                cork_buffer_.write(it->readPtr(), it->length());
+            }
+            return int(chain_len);
+        } else if (err != KMError::AGAIN) {
+            return -1;
+        }
+    }
     if(!sendBufferEmpty()) {
         // try to send buffered data
         auto ret = sendBufferedData();
@@ -161,6 +226,7 @@ int TcpConnection::send(const KMBuffer &buf)
             } else {
                 send_buffer_.reset(buf.subbuffer(ret, chain_len - ret));
             }
+            onSendBufferAppended(chain_len - ret);
         }
         return chain_len;
     }
@@ -170,6 +236,7 @@ int TcpConnection::send(const KMBuffer &buf)
 KMError TcpConnection::close()
 {
     //KM_INFOXTRACE("close");
+    flushCorkBuffer();
     cleanup();
     return KMError::NOERR;
 }
@@ -182,14 +249,95 @@ KMError TcpConnection::sendBufferedData()
             return KMError::SOCK_ERROR;
         } else {
             send_buffer_->bytesRead(ret);
+            send_buffer_size_ -= ret;
             if (send_buffer_->empty()) {
                 send_buffer_.reset();
+                send_buffer_size_ = 0;
             }
         }
     }
     return KMError::NOERR;
 }
 
+KMError TcpConnection::setSendBufferWatermarks(size_t high, size_t low)
+{
+    if (high > 0 && low > high) {
+        return KMError::INVALID_PARAM;
+    }
+    send_high_watermark_ = high;
+    send_low_watermark_ = high > 0 ? low : 0;
+    send_blocked_ = high > 0 && send_buffer_size_ >= high;
+    return KMError::NOERR;
+}
+
+KMError TcpConnection::setCorkEnabled(bool enabled)
+{
+    cork_enabled_ = enabled;
+    if (!enabled && flushCorkBuffer() != KMError::NOERR) {
+        cleanup();
+        onError(KMError::SOCK_ERROR);
+        return KMError::SOCK_ERROR;
+    }
+    return KMError::NOERR;
+}
+
+KMError TcpConnection::reserveCorkBuffer(size_t len)
+{
+    if (len == 0 || !isOpen() || !sendBufferEmpty()) {
+        return KMError::AGAIN;
+    }
+    if (len > kMaxCorkDataSize || cork_buffer_.space() < len) {
+        // keep the data in order
+        if (flushCorkBuffer() != KMError::NOERR) {
+            return KMError::SOCK_ERROR;
+        }
+        if (len > kMaxCorkDataSize || !sendBufferEmpty()) {
+            return KMError::AGAIN;
+        }
+    }
+    if (!cork_flush_scheduled_) {
+        auto loop = eventLoop();
+        if (!loop || loop->post([this] { onCorkFlush(); }, &cork_token_) != kev::Result::OK) {
+            return flushCorkBuffer() == KMError::NOERR ? KMError::AGAIN : KMError::SOCK_ERROR;
+        }
+        cork_flush_scheduled_ = true;
+    }
+    if (cork_buffer_.space() < len) {
+        cork_buffer_.allocBuffer(kCorkBufferSize);
+    }
+    return KMError::NOERR;
+}
+
+KMError TcpConnection::flushCorkBuffer()
+{
+    if (cork_buffer_.length() == 0) {
+        return KMError::NOERR;
+    }
+    int ret = tcp_.send(cork_buffer_.readPtr(), cork_buffer_.length());
+    if (ret < 0) {
+        cork_buffer_.reset();
+        return KMError::SOCK_ERROR;
+    }
+    cork_buffer_.bytesRead(ret);
+    if (cork_buffer_.length() > 0) {
+        // the send buffer shares the storage, don't write to it any more
+        appendSendBuffer(cork_buffer_);
+        cork_buffer_.reset();
+    } else {
+        cork_buffer_.clear();
+    }
+    return KMError::NOERR;
+}
+
+void TcpConnection::onCorkFlush()
+{
+    cork_flush_scheduled_ = false;
+    if (flushCorkBuffer() != KMError::NOERR) {
+        cleanup();
+        onError(KMError::SOCK_ERROR);
+    }
+}
+
 void TcpConnection::appendSendBuffer(const KMBuffer &buf)
 {
     if (send_buffer_) {
@@ -197,11 +345,25 @@ void TcpConnection::appendSendBuffer(const KMBuffer &buf)
     } else {
         send_buffer_.reset(buf.clone());
     }
+    onSendBufferAppended(buf.chainLength());
+}
+
+void TcpConnection::onSendBufferAppended(size_t len)
+{
+    send_buffer_size_ += len;
+    if (send_high_watermark_ > 0 && !send_blocked_ &&
+        send_buffer_size_ >= send_high_watermark_) {
+        KM_WARNTRACE("TcpConnection::onSendBufferAppended, send buffer is full, size=" << send_buffer_size_);
+        send_blocked_ = true;
+    }
 }
 
 void TcpConnection::reset()
 {
+    flushCorkBuffer();
     send_buffer_.reset();
+    send_buffer_size_ = 0;
+    send_blocked_ = false;
     initData_.clear();
 }
 
@@ -212,7 +374,13 @@ void TcpConnection::onSend(KMError err)
         onError(KMError::SOCK_ERROR);
         return;
     }
-    if (sendBufferEmpty() && write_cb_) {
+    if (send_blocked_) {
+        if (send_buffer_size_ > send_low_watermark_) {
+            return;
+        }
+        send_blocked_ = false;
+        if (write_cb_) write_cb_(err);
+    } else if (sendBufferEmpty() && write_cb_) {
         write_cb_(err);
     }
 }
@@ -220,25 +388,37 @@ void TcpConnection::onSend(KMError err)
 void TcpConnection::onReceive(KMError err)
 {
     if(!initData_.empty()) {
-        auto ret = data_cb_(&initData_[0], initData_.size());
+        KMBuffer buf(&initData_[0], initData_.size(), initData_.size());
+        auto ret = notifyData(buf);
         if (ret != KMError::NOERR) {
             return;
         }
         initData_.clear();
     }
-    uint8_t buf[64*1024];
     do {
-        int ret = tcp_.receive(buf, sizeof(buf));
+        // completion based socket receives into its own buffer
+        bool owns_buffer = tcp_.ownsRecvBuffer();
+        if (!owns_buffer && recv_buf_.space() < kMinRecvBufferSpace) {
+            // the previous buffer is released when all the slices of it are released
+            recv_buf_.allocBuffer(kRecvBufferSize);
+        }
+        auto space = recv_buf_.space();
+        // buf refers to recv_buf_, or to the buffer of completion based socket
+        KMBuffer buf;
+        int ret = tcp_.receive(recv_buf_, buf);
         if (ret > 0) {
-            if (data_cb_(buf, ret) != KMError::NOERR) {
+            if (notifyData(buf) != KMError::NOERR) {
                 break;
             }
+            buf.reset();
 #if 1// defined(KUMA_OS_LINUX)
-            if (ret < sizeof(buf)) {
+            if (owns_buffer || static_cast<size_t>(ret) < space) {
+                releaseRecvBuffer();
                 break; // read I/O space is exhausted
             }
 #endif
         } else if (0 == ret) {
+            releaseRecvBuffer();
             break;
         } else { // ret < 0
             cleanup();
@@ -248,6 +428,23 @@ void TcpConnection::onReceive(KMError err)
     } while(true);
 }
 
+void TcpConnection::releaseRecvBuffer()
+{
+    // the socket is drained, don't pin the receive buffer on idle connection.
+    // keep it if the received data is still referenced, its storage is held anyway
+    if (recv_buf_.sharedCount() == 1) {
+        recv_buf_.reset();
+    }
+}
+
+KMError TcpConnection::notifyData(KMBuffer &buf)
+{
+    if (buffer_cb_) {
+        return buffer_cb_(buf);
+    }
+    return data_cb_(static_cast<uint8_t*>(buf.readPtr()), buf.length());
+}
+
 void TcpConnection::onClose(KMError err)
 {
     //KM_INFOXTRACE("onClose");
@@ -31,6 +31,8 @@ class TcpConnection
 public:
     using EventCallback = TcpSocket::EventCallback;
     using DataCallback = std::function<KMError(uint8_t*, size_t)>;
+    // buf shares the receive buffer, retain it by clone() instead of copying data
+    using BufferCallback = std::function<KMError(KMBuffer &)>;
 
     TcpConnection(const EventLoopPtr &loop);
 	virtual ~TcpConnection();
@@ -41,6 +43,12 @@ public:
     virtual KMError connect(const std::string &host, uint16_t port, EventCallback cb);
     virtual KMError attachFd(SOCKET_FD fd, const KMBuffer *init_buf);
     virtual KMError attachSocket(TcpSocket::Impl &&tcp, const KMBuffer *init_buf);
+    /* attach a connected client socket, e.g. an idle connection of the pool
+     */
+    virtual KMError reuseSocket(TcpSocket::Impl &&tcp);
+    /* move the socket to tcp for reuse, all the data must be sent
+     */
+    KMError detachSocket(TcpSocket::Impl &tcp);
     int send(const void* data, size_t len);
     int send(const iovec* iovs, int count);
     int send(const KMBuffer &buf);
@@ -49,15 +57,32 @@ public:
     void doReceive() { onReceive(KMError::NOERR); }
     
     virtual void setDataCallback(DataCallback cb) { data_cb_ = std::move(cb); }
+    // BufferCallback takes precedence over DataCallback if both are set
+    virtual void setBufferCallback(BufferCallback cb) { buffer_cb_ = std::move(cb); }
     virtual void setWriteCallback(EventCallback cb) { write_cb_ = std::move(cb); }
     virtual void setErrorCallback(EventCallback cb) { error_cb_ = std::move(cb); }
 
     bool isServer() const { return isServer_; }
     bool isOpen() const { return tcp_.isReady(); }
-    bool canSendData() const { return isOpen() && sendBufferEmpty(); }
+    bool canSendData() const
+    {
+        return isOpen() && (send_high_watermark_ > 0 ? !send_blocked_ : sendBufferEmpty());
+    }
     
+    /* bound the send buffer. canSendData returns false once the buffered bytes reach
+     * high, and write callback is called when they drop to low.
+     * high = 0 means data can only be sent when the send buffer is empty (default)
+     */
+    KMError setSendBufferWatermarks(size_t high, size_t low);
+    /* gather the small data sent in one loop iteration and flush it with one
+     * system call at the end of the iteration
+     */
+    KMError setCorkEnabled(bool enabled);
+    KMError setZeroCopyThreshold(size_t threshold) { return tcp_.setZeroCopyThreshold(threshold); }
     void appendSendBuffer(const KMBuffer &buf);
     bool sendBufferEmpty() const { return !send_buffer_ || send_buffer_->empty(); }
+    bool sendBufferFull() const { return send_high_watermark_ > 0 && send_blocked_; }
+    size_t sendBufferSize() const { return send_buffer_size_; }
     
 #ifdef KUMA_HAS_OPENSSL
     KMError setAlpnProtocols(const AlpnProtos &protocols) { return tcp_.setAlpnProtocols(protocols); }
@@ -80,19 +105,36 @@ private:
 private:
     void cleanup();
     void saveInitData(const KMBuffer *init_buf);
+    KMError notifyData(KMBuffer &buf);
+    void releaseRecvBuffer();
+    void onSendBufferAppended(size_t len);
+    KMError reserveCorkBuffer(size_t len);
+    KMError flushCorkBuffer();
+    void onCorkFlush();
     
 protected:
     TcpSocket::Impl tcp_;
     std::string host_;
     uint16_t port_{ 0 };
     KMBuffer::Ptr send_buffer_;
+    size_t send_buffer_size_{ 0 };
     
 private:
     std::vector<uint8_t>    initData_;
+    KMBuffer                recv_buf_;
     
     bool                    isServer_{ false };
+    size_t                  send_high_watermark_{ 0 };
+    size_t                  send_low_watermark_{ 0 };
+    bool                    send_blocked_{ false };
+    
+    bool                    cork_enabled_{ false };
+    bool                    cork_flush_scheduled_{ false };
+    KMBuffer                cork_buffer_;
+    EventLoopToken          cork_token_;
 
     DataCallback            data_cb_;
+    BufferCallback          buffer_cb_;
     EventCallback           write_cb_;
     EventCallback           error_cb_;
 };
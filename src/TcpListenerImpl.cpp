@@ -77,6 +77,42 @@ void TcpListener::Impl::setErrorCallback(ErrorCallback cb)
     acceptor_->setErrorCallback(std::move(cb));
 }
 
+KMError TcpListener::Impl::setBacklog(int backlog)
+{
+    acceptor_->setBacklog(backlog);
+    return KMError::NOERR;
+}
+
+KMError TcpListener::Impl::setReusePort(bool enable)
+{
+    return acceptor_->setReusePort(enable);
+}
+
+KMError TcpListener::Impl::setAcceptBudget(uint32_t budget)
+{
+    acceptor_->setAcceptBudget(budget);
+    return KMError::NOERR;
+}
+
+KMError TcpListener::Impl::setSocketOptions(const SocketOptions &opts)
+{
+    acceptor_->setSocketOptions(opts);
+    return KMError::NOERR;
+}
+
+uint16_t TcpListener::Impl::getLocalPort() const
+{
+    sockaddr_storage ss_addr = { 0 };
+    socklen_t ss_len = sizeof(ss_addr);
+    if (getsockname(acceptor_->getFd(), (struct sockaddr*)&ss_addr, &ss_len) != 0) {
+        return 0;
+    }
+    char ip[128] = { 0 };
+    uint16_t port = 0;
+    kev::km_get_sock_addr((struct sockaddr*)&ss_addr, ss_len, ip, sizeof(ip), &port);
+    return port;
+}
+
 KMError TcpListener::Impl::startListen(const std::string &host, uint16_t port)
 {
     return acceptor_->listen(host, port);
@@ -33,6 +33,7 @@ class TcpListener::Impl
 public:
     using AcceptCallback = TcpListener::AcceptCallback;
     using ErrorCallback = TcpListener::ErrorCallback;
+    using SocketOptions = TcpListener::SocketOptions;
     
     Impl(const EventLoopPtr &loop);
     ~Impl();
@@ -41,9 +42,18 @@ public:
     KMError stopListen(const std::string &host, uint16_t port);
     KMError close();
     
+    KMError setBacklog(int backlog);
+    KMError setReusePort(bool enable);
+    KMError setAcceptBudget(uint32_t budget);
+    KMError setSocketOptions(const SocketOptions &opts);
+    
     void setAcceptCallback(AcceptCallback cb);
     void setErrorCallback(ErrorCallback cb);
     
+    /* the port bound by startListen, e.g. the ephemeral one when port 0 is given
+     */
+    uint16_t getLocalPort() const;
+    
 private:
     std::unique_ptr<AcceptorBase> acceptor_;
 };
@@ -139,6 +139,9 @@ TcpSocket::Impl& TcpSocket::Impl::operator= (Impl &&other) noexcept
         ssl_server_name_ = std::move(other.ssl_server_name_);
         ssl_host_name_ = std::move(other.ssl_host_name_);
 #endif
+        send_high_watermark_ = other.send_high_watermark_;
+        send_low_watermark_ = other.send_low_watermark_;
+        zc_threshold_ = other.zc_threshold_;
         connect_cb_ = std::move(other.connect_cb_);
         read_cb_ = std::move(other.read_cb_);
         write_cb_ = std::move(other.write_cb_);
@@ -544,6 +547,36 @@ int TcpSocket::Impl::receive(void *data, size_t length)
     return ret;
 }
 
+int TcpSocket::Impl::receive(KMBuffer &chunk, KMBuffer &buf)
+{
+    if (!isReady()) {
+        return 0;
+    }
+#ifdef KUMA_HAS_OPENSSL
+    if (sslEnabled()) {
+        // the data is decrypted into chunk
+        auto ret = receive(chunk.writePtr(), chunk.space());
+        if (ret > 0) {
+            chunk.bytesWritten(ret);
+            chunk.sliceSelf(buf, chunk.length() - ret, ret);
+            chunk.bytesRead(chunk.length());
+        }
+        return ret;
+    }
+#endif
+    auto ret = socket_->receive(chunk, buf);
+    if (ret < 0) {
+        cleanup();
+    }
+    return ret;
+}
+
+bool TcpSocket::Impl::ownsRecvBuffer() const
+{
+    // the data is decrypted into chunk when ssl is enabled
+    return !sslEnabled() && socket_ && socket_->ownsRecvBuffer();
+}
+
 int TcpSocket::Impl::receive(void *data, size_t length, KMError *last_error)
 {
     if (last_error) {
@@ -615,6 +648,28 @@ KMError TcpSocket::Impl::resume()
     return socket_->resume();
 }
 
+KMError TcpSocket::Impl::setSendBufferWatermarks(size_t high, size_t low)
+{
+    if (high > 0 && low > high) {
+        return KMError::INVALID_PARAM;
+    }
+    send_high_watermark_ = high;
+    send_low_watermark_ = low;
+    if (socket_) {
+        return socket_->setSendBufferWatermarks(high, low);
+    }
+    return KMError::NOERR;
+}
+
+KMError TcpSocket::Impl::setZeroCopyThreshold(size_t threshold)
+{
+    zc_threshold_ = threshold;
+    if (socket_) {
+        return socket_->setZeroCopyThreshold(threshold);
+    }
+    return KMError::NOERR;
+}
+
 void TcpSocket::Impl::onConnect(KMError err)
 {
     KM_INFOXTRACE("onConnect, err=" << int(err));
@@ -704,6 +759,12 @@ bool TcpSocket::Impl::createSocket()
     socket_->setErrorCallback([this](KMError err) {
         onClose(err);
     });
+    if (send_high_watermark_ > 0) {
+        socket_->setSendBufferWatermarks(send_high_watermark_, send_low_watermark_);
+    }
+    if (zc_threshold_ > 0) {
+        socket_->setZeroCopyThreshold(zc_threshold_);
+    }
     return true;
 }
 
@@ -78,10 +78,18 @@ public:
     int send(const KMBuffer &buf);
     int receive(void *data, size_t length);
     int receive(void *data, size_t length, KMError *last_error);
+    /* receive data as buf without copying, see SocketBase::receive
+     */
+    int receive(KMBuffer &chunk, KMBuffer &buf);
+    /* true if the chunk of receive(chunk, buf) is not used
+     */
+    bool ownsRecvBuffer() const;
     KMError close();
     
     KMError pause();
     KMError resume();
+    KMError setSendBufferWatermarks(size_t high, size_t low);
+    KMError setZeroCopyThreshold(size_t threshold);
     
     void setReadCallback(EventCallback cb) { read_cb_ = std::move(cb); }
     void setWriteCallback(EventCallback cb) { write_cb_ = std::move(cb); }
@@ -133,6 +141,10 @@ private:
     std::string         ssl_host_name_;
 #endif
     
+    size_t              send_high_watermark_{ 0 };
+    size_t              send_low_watermark_{ 0 };
+    size_t              zc_threshold_{ 0 };
+    
     EventCallback       connect_cb_;
     EventCallback       read_cb_;
     EventCallback       write_cb_;
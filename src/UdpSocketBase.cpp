@@ -38,6 +38,7 @@
 # include <arpa/inet.h>
 # include <netinet/tcp.h>
 # include <netinet/in.h>
+# include <netinet/udp.h>
 #elif defined(KUMA_OS_MAC)
 # include <string.h>
 # include <pthread.h>
@@ -60,6 +61,20 @@
 #include <stdarg.h>
 #include <errno.h>
 
+#include <algorithm>
+
+#if defined(KUMA_OS_LINUX)
+# ifndef SOL_UDP
+#  define SOL_UDP 17
+# endif
+# ifndef UDP_SEGMENT
+#  define UDP_SEGMENT 103
+# endif
+# ifndef UDP_GRO
+#  define UDP_GRO 104
+# endif
+#endif
+
 #include "EventLoopImpl.h"
 #include "UdpSocketBase.h"
 #include "libkev/src/utils/utils.h"
@@ -74,6 +89,52 @@
 
 using namespace kuma;
 
+namespace {
+    // the max number of datagrams per recvmmsg/sendmmsg call
+    const int kMaxBatchSize = 64;
+    // the max number of iovecs per datagram before falling back to heap
+    const int kMaxDatagramIovs = 4;
+    
+#if defined(KUMA_OS_LINUX)
+    // the size of control message for UDP_SEGMENT or UDP_GRO
+    const size_t kSegmentCmsgSpace = CMSG_SPACE(sizeof(int));
+    
+    void setSegmentCmsg(msghdr &msg, char *control, uint16_t segment_size)
+    {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        auto *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    }
+    
+    uint16_t getSegmentCmsg(msghdr &msg)
+    {
+        for (auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int gso_size = 0;
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                return static_cast<uint16_t>(gso_size);
+            }
+        }
+        return 0;
+    }
+#endif
+    
+    bool isWouldBlock(int err)
+    {
+        return EAGAIN == err ||
+#ifdef KUMA_OS_WIN
+        WSAEWOULDBLOCK
+#else
+        EWOULDBLOCK
+#endif
+        == err;
+    }
+}
+
 static bool getSockAddr(const std::string &host, uint16_t port, sockaddr_storage &ss_addr);
 
 KUMA_NS_BEGIN
@@ -280,6 +341,29 @@ void UdpSocketBase::setSocketOption()
     
     int opt_val = 1;
     setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt_val, sizeof(int));
+    
+#if defined(KUMA_OS_LINUX)
+    if (gro_enabled_ && setsockopt(fd_, SOL_UDP, UDP_GRO, (char*)&opt_val, sizeof(int)) != 0) {
+        KM_WARNXTRACE("setSocketOption, failed to set UDP_GRO, err="<<kev::SKUtils::getLastError());
+    }
+#endif
+}
+
+KMError UdpSocketBase::setGroEnabled(bool enable)
+{
+#if defined(KUMA_OS_LINUX)
+    if (INVALID_FD != fd_) {
+        int opt_val = enable ? 1 : 0;
+        if (setsockopt(fd_, SOL_UDP, UDP_GRO, (char*)&opt_val, sizeof(int)) != 0) {
+            KM_ERRXTRACE("setGroEnabled, failed to set UDP_GRO, err="<<kev::SKUtils::getLastError());
+            return KMError::NOT_SUPPORTED;
+        }
+    }
+    gro_enabled_ = enable;
+    return KMError::NOERR;
+#else
+    return enable ? KMError::NOT_SUPPORTED : KMError::NOERR;
+#endif
 }
 
 KMError UdpSocketBase::mcastJoin(const std::string &mcast_addr, uint16_t mcast_port)
@@ -501,6 +585,31 @@ int UdpSocketBase::send(const KMBuffer &buf, const std::string &host, uint16_t p
     return ret;
 }
 
+int UdpSocketBase::send(const KMBuffer &buf, const std::string &host, uint16_t port, uint16_t segment_size)
+{
+    auto length = buf.chainLength();
+    if (segment_size == 0 || length <= segment_size) {
+        return send(buf, host, port);
+    }
+#if defined(KUMA_OS_LINUX)
+    Datagram dgram;
+    if (!connected_) {
+        if (host.size() >= sizeof(dgram.ip)) {
+            KM_ERRXTRACE("send, host is too long, host=" << host);
+            return -1;
+        }
+        memcpy(dgram.ip, host.c_str(), host.size() + 1);
+        dgram.port = port;
+    }
+    dgram.buf = const_cast<KMBuffer*>(&buf);
+    dgram.segment_size = segment_size;
+    auto ret = sendBatch(&dgram, 1);
+    return ret == 1 ? static_cast<int>(length) : ret;
+#else
+    return int(KMError::NOT_SUPPORTED);
+#endif
+}
+
 int UdpSocketBase::receive(void *data, size_t length, char *ip, size_t ip_len, uint16_t &port)
 {
     if(INVALID_FD == fd_) {
@@ -542,6 +651,195 @@ int UdpSocketBase::receive(void *data, size_t length, char *ip, size_t ip_len, u
     return static_cast<int>(ret);
 }
 
+int UdpSocketBase::receiveBatch(Datagram *dgrams, int count)
+{
+    if(INVALID_FD == fd_) {
+        KM_ERRXTRACE("receiveBatch, invalid fd");
+        return -1;
+    }
+    if (!dgrams || count <= 0) {
+        return 0;
+    }
+#if defined(KUMA_OS_LINUX)
+    mmsghdr msgs[kMaxBatchSize];
+    iovec iovs[kMaxBatchSize];
+    sockaddr_storage addrs[kMaxBatchSize];
+    alignas(cmsghdr) char controls[kMaxBatchSize][kSegmentCmsgSpace];
+    int total = 0;
+    while (total < count) {
+        int n = std::min(count - total, kMaxBatchSize);
+        for (int i = 0; i < n; ++i) {
+            auto *buf = dgrams[total + i].buf;
+            if (!buf) {
+                return total > 0 ? total : int(KMError::INVALID_PARAM);
+            }
+            iovs[i].iov_base = buf->writePtr();
+            iovs[i].iov_len = buf->space();
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            if (!connected_) {
+                msgs[i].msg_hdr.msg_name = &addrs[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            }
+            if (gro_enabled_) {
+                msgs[i].msg_hdr.msg_control = controls[i];
+                msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+            }
+        }
+        int ret = ::recvmmsg(fd_, msgs, n, 0, nullptr);
+        if (ret < 0) {
+            auto err = kev::SKUtils::getLastError();
+            if (EINTR == err) {
+                continue;
+            }
+            if (!isWouldBlock(err)) {
+                KM_ERRXTRACE("receiveBatch, failed, err=" << err);
+                return total > 0 ? total : -1;
+            }
+            break;
+        }
+        for (int i = 0; i < ret; ++i) {
+            auto &dgram = dgrams[total + i];
+            dgram.buf->bytesWritten(msgs[i].msg_len);
+            dgram.segment_size = gro_enabled_ ? getSegmentCmsg(msgs[i].msg_hdr) : 0;
+            if (!connected_) {
+                kev::km_get_sock_addr((struct sockaddr*)&addrs[i], sizeof(addrs[i]), dgram.ip, sizeof(dgram.ip), &dgram.port);
+            }
+        }
+        total += ret;
+        if (ret < n) {
+            break;
+        }
+    }
+    return total;
+#else
+    return receiveEach(dgrams, count);
+#endif
+}
+
+int UdpSocketBase::sendBatch(const Datagram *dgrams, int count)
+{
+    if (!dgrams || count <= 0) {
+        return 0;
+    }
+#if defined(KUMA_OS_LINUX)
+    if (INVALID_FD == fd_) {
+        // the socket is created on first send
+        sockaddr_storage ss_addr = {0};
+        if (!getSockAddr(dgrams[0].ip, dgrams[0].port, ss_addr) || !initSocket(ss_addr.ss_family)) {
+            KM_ERRXTRACE("sendBatch, failed to init socket, host=" << dgrams[0].ip << ", port=" << dgrams[0].port);
+            return -1;
+        }
+        printSocket();
+        onSocketInitialized();
+    }
+    mmsghdr msgs[kMaxBatchSize];
+    iovec iovs[kMaxBatchSize][kMaxDatagramIovs];
+    iovec* heap_iovs[kMaxBatchSize];
+    sockaddr_storage addrs[kMaxBatchSize];
+    alignas(cmsghdr) char controls[kMaxBatchSize][kSegmentCmsgSpace];
+    int total = 0;
+    bool invalid_dest = false;
+    while (total < count && !invalid_dest) {
+        int n = std::min(count - total, kMaxBatchSize);
+        for (int i = 0; i < n; ++i) {
+            auto &dgram = dgrams[total + i];
+            heap_iovs[i] = iovs[i];
+            int iov_count = 0;
+            if (dgram.buf) {
+                iov_count = to_iovecs(*dgram.buf, iovs[i], kMaxDatagramIovs, &heap_iovs[i]);
+            }
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = heap_iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = iov_count;
+            if (dgram.segment_size > 0) {
+                setSegmentCmsg(msgs[i].msg_hdr, controls[i], dgram.segment_size);
+            }
+            if (!connected_) {
+                memset(&addrs[i], 0, sizeof(addrs[i]));
+                if (!getSockAddr(dgram.ip, dgram.port, addrs[i])) {
+                    KM_ERRXTRACE("sendBatch, cannot resolve host, host=" << dgram.ip << ", port=" << dgram.port);
+                    if (heap_iovs[i] != iovs[i]) {
+                        delete[] heap_iovs[i];
+                    }
+                    invalid_dest = true;
+                    n = i; // send the datagrams before it
+                    break;
+                }
+                msgs[i].msg_hdr.msg_name = &addrs[i];
+                msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(kev::km_get_addr_length(addrs[i]));
+            }
+        }
+        int ret = n > 0 ? ::sendmmsg(fd_, msgs, n, 0) : 0;
+        auto err = ret < 0 ? kev::SKUtils::getLastError() : 0;
+        for (int i = 0; i < n; ++i) {
+            if (heap_iovs[i] != iovs[i]) {
+                delete[] heap_iovs[i];
+            }
+        }
+        if (ret < 0) {
+            if (EINTR == err) {
+                continue;
+            }
+            if (!isWouldBlock(err)) {
+                KM_ERRXTRACE("sendBatch, failed, err=" << err);
+                return total > 0 ? total : -1;
+            }
+            notifySendBlocked();
+            break;
+        }
+        total += ret;
+        if (ret < n) {
+            notifySendBlocked();
+            break;
+        }
+    }
+    return total > 0 || !invalid_dest ? total : -1;
+#else
+    return sendEach(dgrams, count);
+#endif
+}
+
+int UdpSocketBase::receiveEach(Datagram *dgrams, int count)
+{
+    int total = 0;
+    for (; total < count; ++total) {
+        auto &dgram = dgrams[total];
+        if (!dgram.buf) {
+            break;
+        }
+        auto ret = receive(dgram.buf->writePtr(), dgram.buf->space(), dgram.ip, sizeof(dgram.ip), dgram.port);
+        if (ret <= 0) {
+            if (ret < 0 && total == 0) {
+                return ret;
+            }
+            break;
+        }
+        dgram.buf->bytesWritten(ret);
+    }
+    return total;
+}
+
+int UdpSocketBase::sendEach(const Datagram *dgrams, int count)
+{
+    int total = 0;
+    for (; total < count; ++total) {
+        auto &dgram = dgrams[total];
+        if (!dgram.buf) {
+            break;
+        }
+        auto ret = send(*dgram.buf, dgram.ip, dgram.port);
+        if (ret <= 0) {
+            if (ret < 0 && total == 0) {
+                return ret;
+            }
+            break;
+        }
+    }
+    return total;
+}
+
 KMError UdpSocketBase::close()
 {
     KM_INFOXTRACE("close");
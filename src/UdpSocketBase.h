@@ -40,6 +40,7 @@ class UdpSocketBase : public kev::KMObject, public kev::DestroyDetector
 {
 public:
     using EventCallback = UdpSocket::EventCallback;
+    using Datagram = UdpSocket::Datagram;
     
     UdpSocketBase(const EventLoopPtr &loop);
     virtual ~UdpSocketBase();
@@ -49,7 +50,11 @@ public:
     virtual int send(const void *data, size_t length, const std::string &host, uint16_t port);
     virtual int send(const iovec *iovs, int count, const std::string &host, uint16_t port);
     virtual int send(const KMBuffer &buf, const std::string &host, uint16_t port);
+    virtual int send(const KMBuffer &buf, const std::string &host, uint16_t port, uint16_t segment_size);
     virtual int receive(void *data, size_t length, char *ip, size_t ip_len, uint16_t &port);
+    virtual int receiveBatch(Datagram *dgrams, int count);
+    virtual int sendBatch(const Datagram *dgrams, int count);
+    KMError setGroEnabled(bool enable);
     virtual KMError close();
     
     KMError mcastJoin(const std::string &mcast_addr, uint16_t mcast_port);
@@ -62,6 +67,8 @@ public:
     
 protected:
     void setSocketOption();
+    int receiveEach(Datagram *dgrams, int count);
+    int sendEach(const Datagram *dgrams, int count);
     virtual void onSend(KMError err);
     virtual void onReceive(KMError err);
     virtual void onClose(KMError err);
@@ -82,6 +89,7 @@ protected:
     EventLoopWeakPtr    loop_;
     bool                registered_{ false };
     bool                connected_{ false };
+    bool                gro_enabled_{ false };
     uint32_t            flags_{ 0 };
     
     EventCallback       read_cb_;
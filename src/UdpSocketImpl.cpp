@@ -142,6 +142,26 @@ int UdpSocket::Impl::receive(void *data, size_t length, char *ip, size_t ip_len,
     return socket_->receive(data, length, ip, ip_len, port);
 }
 
+int UdpSocket::Impl::receiveBatch(Datagram *dgrams, int count)
+{
+    return socket_->receiveBatch(dgrams, count);
+}
+
+int UdpSocket::Impl::sendBatch(const Datagram *dgrams, int count)
+{
+    return socket_->sendBatch(dgrams, count);
+}
+
+int UdpSocket::Impl::send(const KMBuffer &buf, const std::string &host, uint16_t port, uint16_t segment_size)
+{
+    return socket_->send(buf, host, port, segment_size);
+}
+
+KMError UdpSocket::Impl::setGroEnabled(bool enable)
+{
+    return socket_->setGroEnabled(enable);
+}
+
 KMError UdpSocket::Impl::close()
 {
     return socket_->close();
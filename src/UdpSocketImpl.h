@@ -38,6 +38,7 @@ class UdpSocket::Impl
 {
 public:
     using EventCallback = UdpSocket::EventCallback;
+    using Datagram = UdpSocket::Datagram;
     
     Impl(const EventLoopPtr &loop);
     ~Impl();
@@ -47,7 +48,11 @@ public:
     int send(const void *data, size_t length, const std::string &host, uint16_t port);
     int send(const iovec *iovs, int count, const std::string &host, uint16_t port);
     int send(const KMBuffer &buf, const std::string &host, uint16_t port);
+    int send(const KMBuffer &buf, const std::string &host, uint16_t port, uint16_t segment_size);
     int receive(void *data, size_t length, char *ip, size_t ip_len, uint16_t &port);
+    int receiveBatch(Datagram *dgrams, int count);
+    int sendBatch(const Datagram *dgrams, int count);
+    KMError setGroEnabled(bool enable);
     KMError close();
     
     KMError mcastJoin(const std::string &mcast_addr, uint16_t mcast_port);
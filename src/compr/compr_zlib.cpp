@@ -36,19 +36,25 @@ KMError ZLibCompressor::init(const std::string &type, int max_window_bits)
     if (max_window_bits > 15 || max_window_bits < 8) {
         return KMError::INVALID_PARAM;
     }
-    if (initizlized_) {
-        deflateEnd(&c_stream);
-        initizlized_ = false;
-    }
+    int window_bits = 0;
     if (kev::is_equal(type, "gzip")) {
-        c_max_window_bits = max_window_bits + 16;
+        window_bits = max_window_bits + 16;
     } else if (kev::is_equal(type, "raw-deflate")) {
-        c_max_window_bits = -1 * max_window_bits;
+        window_bits = -1 * max_window_bits;
     } else if (kev::is_equal(type, "deflate")) {
-        c_max_window_bits = max_window_bits;
+        window_bits = max_window_bits;
     } else {
         return KMError::INVALID_PARAM;
     }
+    if (initizlized_) {
+        if (window_bits == c_max_window_bits && deflateReset(&c_stream) == Z_OK) {
+            // reuse the allocated state
+            return KMError::NOERR;
+        }
+        deflateEnd(&c_stream);
+        initizlized_ = false;
+    }
+    c_max_window_bits = window_bits;
     auto ret = deflateInit2(&c_stream,
                             Z_DEFAULT_COMPRESSION,
                             Z_DEFLATED,
@@ -20,18 +20,25 @@
  */
 
 #include "H1xStream.h"
+#include "HttpConnectionPool.h"
 #include "libkev/src/utils/kmtrace.h"
+#include "libkev/src/utils/utils.h"
 
 
 using namespace kuma;
 
+namespace {
+    // the pipelined requests that can be buffered while one request is being responded
+    const size_t kMaxPipelinedBytes = 1024 * 1024;
+}
+
 H1xStream::H1xStream(const EventLoopPtr &loop)
 : tcp_conn_(loop)
 {
     loop_token_.eventLoop(loop);
 
-    tcp_conn_.setDataCallback([this](uint8_t *data, size_t size) {
-        return handleInputData(data, size);
+    tcp_conn_.setBufferCallback([this](KMBuffer &buf) {
+        return handleInputData(buf);
     });
     tcp_conn_.setWriteCallback([this] (KMError) {
         onWrite();
@@ -78,26 +85,109 @@ KMError H1xStream::sendRequest(const std::string &method, const std::string &url
     version_ = ver;
     wait_outgoing_complete_ = false;
     is_stream_upgraded_ = false;
+    retry_allowed_ = false;
     incoming_parser_.setRequestMethod(method);
-    if (!tcp_conn_.isOpen()) {
-        std::string str_port = uri_.getPort();
-        uint16_t port = 80;
-        uint32_t ssl_flags = SSL_NONE;
-        if(kev::is_equal("https", uri_.getScheme())) {
-            port = 443;
-            ssl_flags = SSL_ENABLE | tcp_conn_.getSslFlags();
+    std::string str_port = uri_.getPort();
+    uint16_t port = 80;
+    uint32_t ssl_flags = SSL_NONE;
+    if(kev::is_equal("https", uri_.getScheme())) {
+        port = 443;
+        ssl_flags = SSL_ENABLE | tcp_conn_.getSslFlags();
+    }
+    if(!str_port.empty()) {
+        port = std::stoi(str_port);
+    }
+    auto conn_key = getConnectionKey(port, ssl_flags);
+    if (tcp_conn_.isOpen() && conn_key != conn_key_) {
+        // connected to another server
+        tcp_conn_.close();
+    }
+    conn_key_ = std::move(conn_key);
+    conn_port_ = port;
+    if (tcp_conn_.isOpen()) {
+        return sendHeaders(buildRequest());
+    }
+    if (reuseConnection()) {
+        auto ret = sendHeaders(buildRequest());
+        if (ret == KMError::NOERR) {
+            retry_allowed_ = !outgoing_message_.hasBody();
+            return ret;
         }
-        if(!str_port.empty()) {
-            port = std::stoi(str_port);
+        KM_WARNXTRACE("sendRequest, failed to send on pooled connection, err=" << int(ret));
+        tcp_conn_.close();
+        tcp_conn_.reset();
+    }
+    tcp_conn_.setSslFlags(ssl_flags);
+    return connectServer();
+}
+
+KMError H1xStream::connectServer()
+{
+    return tcp_conn_.connect(uri_.getHost(), conn_port_, [this] (KMError err) {
+        onConnect(err);
+    });
+}
+
+std::string H1xStream::getConnectionKey(uint16_t port, uint32_t ssl_flags) const
+{
+    std::string key = uri_.getScheme() + "://" + uri_.getHost() + ":" + std::to_string(port);
+    key += "|" + std::to_string(ssl_flags);
+    auto &proxy_info = tcp_conn_.getProxyInfo();
+    if (!proxy_info.url.empty()) {
+        key += "|" + proxy_info.url + "|" + proxy_info.user;
+    }
+    return key;
+}
+
+bool H1xStream::reuseConnection()
+{
+    auto pool = HttpConnectionPool::getPool(tcp_conn_.eventLoop(), false);
+    if (!pool) {
+        return false;
+    }
+    auto tcp = pool->getConnection(conn_key_);
+    if (!tcp) {
+        return false;
+    }
+    return tcp_conn_.reuseSocket(std::move(*tcp)) == KMError::NOERR;
+}
+
+bool H1xStream::canReuseConnection() const
+{
+    if (is_stream_upgraded_ || !outgoing_message_.isComplete() || !incoming_parser_.complete()) {
+        return false;
+    }
+    if (kev::contains_token(outgoing_message_.getHeader(keyConnection), "close", ',')) {
+        return false;
+    }
+    auto &conn = incoming_parser_.getHeader(keyConnection);
+    if (kev::contains_token(conn, "close", ',')) {
+        return false;
+    }
+    if (!kev::is_equal(incoming_parser_.getVersion(), VersionHTTP1_1)) {
+        // HTTP/1.0
+        return kev::contains_token(conn, "keep-alive", ',');
+    }
+    return true;
+}
+
+void H1xStream::releaseConnection()
+{
+    if (tcp_conn_.isServer() || !tcp_conn_.isOpen()) {
+        return;
+    }
+    if (canReuseConnection()) {
+        auto loop = tcp_conn_.eventLoop();
+        auto pool = HttpConnectionPool::getPool(loop, true);
+        if (pool) {
+            auto tcp = std::make_unique<TcpSocket::Impl>(loop);
+            if (tcp_conn_.detachSocket(*tcp) == KMError::NOERR) {
+                pool->addConnection(conn_key_, std::move(tcp));
+                return;
+            }
         }
-        tcp_conn_.setSslFlags(ssl_flags);
-        return tcp_conn_.connect(uri_.getHost(), port, [this] (KMError err) {
-            onConnect(err);
-        });
-    } else {
-        auto req = buildRequest();
-        return sendHeaders(req);
     }
+    tcp_conn_.close();
 }
 
 KMError H1xStream::attachFd(SOCKET_FD fd, const KMBuffer *init_buf)
@@ -143,11 +233,23 @@ KMError H1xStream::attachSocket(TcpSocket::Impl&& tcp, HttpParser::Impl&& parser
 
 KMError H1xStream::sendResponse(int status_code, const std::string &desc, const std::string &ver)
 {
-    auto rsp = buildResponse(status_code, desc, ver);
-    return sendHeaders(rsp);
+    outgoing_message_.buildHeader(status_code, desc, ver, incoming_parser_.getMethod(), header_buf_);
+    return sendHeaders(header_buf_);
+}
+
+KMError H1xStream::sendResponse(const HttpHeaderTemplate::Impl &tpl, size_t content_length)
+{
+    outgoing_message_.setContentLength(content_length);
+    if (!tpl.getConnection().empty()) {
+        // not serialized, it decides if the connection is kept alive as other responses
+        outgoing_message_.addHeader(strConnection, tpl.getConnection());
+    }
+    outgoing_message_.processHeader(tpl.getStatusCode(), incoming_parser_.getMethod());
+    tpl.buildHeader(header_buf_, content_length);
+    return sendHeaders(header_buf_);
 }
 
-std::string H1xStream::buildRequest()
+const std::string& H1xStream::buildRequest()
 {
     std::string url = uri_.getPath();
     if (!uri_.getQuery().empty()) {
@@ -158,14 +260,8 @@ std::string H1xStream::buildRequest()
         url += "#";
         url += uri_.getFragment();
     }
-    auto req = outgoing_message_.buildHeader(method_, url, version_);
-    return req;
-}
-
-std::string H1xStream::buildResponse(int status_code, const std::string &desc, const std::string &ver)
-{
-    auto rsp = outgoing_message_.buildHeader(status_code, desc, ver, incoming_parser_.getMethod());
-    return rsp;
+    outgoing_message_.buildHeader(method_, url, version_, header_buf_);
+    return header_buf_;
 }
 
 KMError H1xStream::sendHeaders(const std::string &headers)
@@ -252,23 +348,31 @@ void H1xStream::onConnect(KMError err)
     }
 }
 
-KMError H1xStream::handleInputData(uint8_t *src, size_t len)
+KMError H1xStream::handleInputData(KMBuffer &buf)
 {// TcpConnection.handleInputData
+    retry_allowed_ = false;
     if (!is_stream_upgraded_) {
+        if (pipelined_buf_) {
+            // keep the order of pipelined requests
+            return savePipelinedData(buf, 0);
+        }
+        auto len = buf.chainLength();
         DESTROY_DETECTOR_SETUP();
-        int bytes_used = incoming_parser_.parse((char*)src, len);
+        int bytes_used = incoming_parser_.parse(buf);
         DESTROY_DETECTOR_CHECK(KMError::DESTROYED);
         if (!is_stream_upgraded_ || bytes_used >= static_cast<int>(len)) {
             if (bytes_used < static_cast<int>(len)) {
+                if (tcp_conn_.isServer() && incoming_parser_.complete()) {
+                    // pipelined request, it is parsed after the response completes
+                    return savePipelinedData(buf, bytes_used);
+                }
                 KM_WARNXTRACE("handleInputData, data is not consumed, len=" << len << ", used=" << bytes_used);
             }
             return KMError::NOERR;
         }
-        len -= bytes_used;
-        src += bytes_used;
+        buf.bytesRead(bytes_used);
     }
 
-    KMBuffer buf(src, len, len);
     DESTROY_DETECTOR_SETUP();
     onStreamData(buf);
     DESTROY_DETECTOR_CHECK(KMError::DESTROYED);
@@ -276,9 +380,37 @@ KMError H1xStream::handleInputData(uint8_t *src, size_t len)
     return KMError::NOERR;
 }
 
+KMError H1xStream::savePipelinedData(const KMBuffer &buf, size_t offset)
+{
+    auto len = buf.chainLength();
+    if (offset >= len) {
+        return KMError::NOERR;
+    }
+    len -= offset;
+    if (pipelined_bytes_ + len > kMaxPipelinedBytes) {
+        KM_ERRXTRACE("savePipelinedData, too much pipelined data, bytes=" << pipelined_bytes_ + len);
+        DESTROY_DETECTOR_SETUP();
+        onStreamError(KMError::BUFFER_TOO_SMALL);
+        DESTROY_DETECTOR_CHECK(KMError::DESTROYED);
+        return KMError::BUFFER_TOO_SMALL;
+    }
+    // shares the receive buffer without copying
+    auto *kmb = buf.subbuffer(offset, len);
+    if (pipelined_buf_) {
+        pipelined_buf_->append(kmb);
+    } else {
+        pipelined_buf_.reset(kmb);
+    }
+    pipelined_bytes_ += len;
+    return KMError::NOERR;
+}
+
 void H1xStream::onWrite()
 {// TcpConnection.onWrite
     if (wait_outgoing_complete_) {
+        if (!tcp_conn_.sendBufferEmpty()) {
+            return; // drained to low watermark, wait for all data sent
+        }
         wait_outgoing_complete_ = false;
         onOutgoingComplete();
     } else if (write_cb_) {
@@ -314,6 +446,9 @@ void H1xStream::onHttpEvent(HttpEvent ev)
             break;
             
         case HttpEvent::HTTP_ERROR:
+            if (tcp_conn_.isServer() && !incoming_parser_.headerComplete()) {
+                rejectRequest(incoming_parser_.getErrorStatus());
+            }
             onError(KMError::FAILED);
             break;
             
@@ -322,6 +457,18 @@ void H1xStream::onHttpEvent(HttpEvent ev)
     }
 }
 
+void H1xStream::rejectRequest(int status_code)
+{
+    // the request is not delivered to user, reply directly and stop reading
+    KM_WARNXTRACE("rejectRequest, status=" << status_code);
+    std::string rsp = "HTTP/1.1 " + std::to_string(status_code);
+    rsp += status_code == 431 ? " Request Header Fields Too Large" : " Bad Request";
+    rsp += "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    tcp_conn_.send(rsp.data(), rsp.size());
+    pipelined_buf_.reset();
+    pipelined_bytes_ = 0;
+}
+
 void H1xStream::onHeaderComplete()
 {
     if (header_cb_) header_cb_();
@@ -347,6 +494,18 @@ void H1xStream::onIncomingComplete()
 
 void H1xStream::onStreamError(KMError err)
 {
+    if (retry_allowed_) {
+        // the idle connection was closed by server before the request arrived
+        retry_allowed_ = false;
+        KM_INFOXTRACE("onStreamError, resend request on new connection, err=" << int(err));
+        tcp_conn_.close();
+        tcp_conn_.reset();
+        incoming_parser_.reset();
+        incoming_parser_.setRequestMethod(method_);
+        if (connectServer() == KMError::NOERR) {
+            return;
+        }
+    }
     if(error_cb_) error_cb_(err);
 }
 
@@ -357,17 +516,44 @@ void H1xStream::reset()
     wait_outgoing_complete_ = false;
     incoming_parser_.reset();
     is_stream_upgraded_ = false;
+    retry_allowed_ = false;
 }
 
 void H1xStream::readyForReuse()
 {
     reset();
+    if (pipelined_buf_) {
+        // parse the pipelined request without waiting for new data, but not in the
+        // call stack of user's reset. the data received before it is appended in order
+        runOnLoopThread([this] { parsePipelinedData(); }, false);
+        return;
+    }
+    // try to receive new request
+    tcp_conn_.doReceive();
+}
+
+void H1xStream::parsePipelinedData()
+{
+    if (!pipelined_buf_) {
+        return;
+    }
+    auto buf = std::move(pipelined_buf_);
+    pipelined_bytes_ = 0;
+    DESTROY_DETECTOR_SETUP();
+    auto ret = handleInputData(*buf);
+    DESTROY_DETECTOR_CHECK_VOID();
+    if (ret != KMError::NOERR || pipelined_buf_) {
+        // wait for the response of the pipelined request
+        return;
+    }
     // try to receive new request
     tcp_conn_.doReceive();
 }
 
 KMError H1xStream::close()
 {
+    pipelined_buf_.reset();
+    pipelined_bytes_ = 0;
     tcp_conn_.close();
     loop_token_.reset();
     return KMError::NOERR;
@@ -27,6 +27,7 @@
 #include "http/HttpHeader.h"
 #include "http/HttpMessage.h"
 #include "http/HttpParserImpl.h"
+#include "http/HttpHeaderTemplate.h"
 #include "http/Uri.h"
 #include "libkev/src/utils/kmobject.h"
 #include "libkev/src/utils/DestroyDetector.h"
@@ -56,14 +57,25 @@ public:
     KMError attachFd(SOCKET_FD fd, const KMBuffer *init_buf);
     KMError attachSocket(TcpSocket::Impl&& tcp, HttpParser::Impl&& parser, const KMBuffer *init_buf);
     KMError sendResponse(int status_code, const std::string &desc, const std::string &ver);
+    KMError sendResponse(const HttpHeaderTemplate::Impl &tpl, size_t content_length);
     int sendData(const void* data, size_t len);
     int sendData(const KMBuffer &buf);
     void reset();
     void readyForReuse();
+    /* the client connection is kept in the connection pool if the response allows
+     * keep-alive, otherwise it is closed
+     */
+    void releaseConnection();
     KMError close();
     
     bool isServer() const { return tcp_conn_.isServer(); }
     bool canSendData() const { return tcp_conn_.canSendData(); }
+    KMError setSendBufferWatermarks(size_t high, size_t low)
+    {
+        return tcp_conn_.setSendBufferWatermarks(high, low);
+    }
+    KMError setCorkEnabled(bool enabled) { return tcp_conn_.setCorkEnabled(enabled); }
+    KMError setZeroCopyThreshold(size_t threshold) { return tcp_conn_.setZeroCopyThreshold(threshold); }
     
     bool isOutgoingComplete() const { return outgoing_message_.isComplete(); }
     bool isIncomingComplete() const { return incoming_parser_.complete(); }
@@ -105,14 +117,21 @@ public:
     
 protected: // callbacks of TcpConnection
     void onConnect(KMError err);
-    KMError handleInputData(uint8_t *src, size_t len);
+    KMError handleInputData(KMBuffer &buf);
     void onWrite();
     void onError(KMError err);
     
 protected:
-    std::string buildRequest();
-    std::string buildResponse(int status_code, const std::string &desc, const std::string &ver);
+    // the header is built into header_buf_
+    const std::string& buildRequest();
     KMError sendHeaders(const std::string &headers);
+    KMError connectServer();
+    bool reuseConnection();
+    bool canReuseConnection() const;
+    std::string getConnectionKey(uint16_t port, uint32_t ssl_flags) const;
+    KMError savePipelinedData(const KMBuffer &buf, size_t offset);
+    void parsePipelinedData();
+    void rejectRequest(int status_code);
     
     void onHeaderComplete();
     void onStreamData(KMBuffer &buf);
@@ -129,8 +148,20 @@ protected:
     std::string             version_;
     HttpMessage             outgoing_message_;
     bool                    wait_outgoing_complete_ = false;
+    // the outgoing header is built here, the capacity is kept for next message
+    std::string             header_buf_;
+    // the data of pipelined requests received before the response completes,
+    // it shares the receive buffer and is parsed when the stream is ready for reuse
+    KMBuffer::Ptr           pipelined_buf_;
+    size_t                  pipelined_bytes_ = 0;
     HttpParser::Impl        incoming_parser_;
     bool                    is_stream_upgraded_ = false;
+    // the key of the connection in the connection pool
+    std::string             conn_key_;
+    uint16_t                conn_port_ = 0;
+    // the request was sent on a pooled connection and nothing is received yet,
+    // it is resent on a new connection if the server has closed the connection
+    bool                    retry_allowed_ = false;
     
     HeaderCallback          header_cb_;
     DataCallback            data_cb_;
@@ -22,7 +22,6 @@
 #include "Http1xRequest.h"
 #include "libkev/src/utils/kmtrace.h"
 #include "libkev/src/utils/utils.h"
-#include "HttpCache.h"
 
 #include <sstream>
 #include <iterator>
@@ -49,7 +48,7 @@ Http1xRequest::Http1xRequest(const EventLoopPtr &loop, std::string ver)
         //onError(err);
     });
     stream_->setIncomingCompleteCallback([this] {
-        onResponseComplete();
+        onIncomingComplete();
     });
     stream_->setOutgoingCompleteCallback([this] {
         onRequestComplete();
@@ -60,11 +59,12 @@ Http1xRequest::Http1xRequest(const EventLoopPtr &loop, std::string ver)
 
 Http1xRequest::~Http1xRequest()
 {
-    
+    stream_->releaseConnection();
 }
 
 void Http1xRequest::cleanup()
 {
+    stream_->releaseConnection();
     stream_->close();
 }
 
@@ -110,8 +110,8 @@ KMError Http1xRequest::sendRequest()
 
 int Http1xRequest::getStatusCode() const
 {
-    if (rsp_cache_status_ != 0) {
-        return rsp_cache_status_;
+    if (rsp_cache_) {
+        return rsp_cache_->status_code;
     } else {
         return stream_->getStatusCode();
     }
@@ -143,9 +143,9 @@ int Http1xRequest::sendBody(const KMBuffer &buf)
 void Http1xRequest::reset()
 {
     HttpRequest::Impl::reset();
+    // the connection is taken again from the pool if next request is to same server
+    stream_->releaseConnection();
     stream_->reset();
-    rsp_cache_status_ = 0;
-    rsp_cache_body_.reset();
 }
 
 KMError Http1xRequest::close()
@@ -185,21 +185,8 @@ void Http1xRequest::onRequestComplete()
 
 bool Http1xRequest::processHttpCache()
 {
-    if (!HttpCache::isCacheable(method_, getRequestHeader().getHeaders())) {
-        return false;
-    }
-    std::string cache_key = getCacheKey();
-    
-    int status_code = 0;
-    HeaderVector rsp_headers;
-    KMBuffer rsp_body;
-    if (HttpCache::instance().getCache(cache_key, status_code, rsp_headers, rsp_body)) {
+    if (checkHttpCache()) {
         // cache hit
-        setState(State::RECVING_RESPONSE);
-        auto &rsp_header = getResponseHeader();
-        rsp_header.setHeaders(std::move(rsp_headers));
-        rsp_cache_status_ = status_code;
-        rsp_cache_body_.reset(rsp_body.clone());
         stream_->runOnLoopThread([this] { onCacheComplete(); }, false);
         return true;
     }
@@ -214,11 +201,18 @@ void Http1xRequest::onCacheComplete()
     DESTROY_DETECTOR_SETUP();
     onResponseHeaderComplete();
     DESTROY_DETECTOR_CHECK_VOID();
-    if (rsp_cache_body_ && !rsp_cache_body_->empty() && data_cb_) {
+    onIncomingComplete();
+}
+
+void Http1xRequest::onIncomingComplete()
+{
+    // the body of cached response, or the response refreshed by 304
+    if (rsp_cache_ && !rsp_cache_->body.empty() && data_cb_) {
+        // shares the storage of cached body
+        KMBuffer body(rsp_cache_->body);
         DESTROY_DETECTOR_SETUP();
-        onResponseData(*rsp_cache_body_);
+        onResponseData(body);
         DESTROY_DETECTOR_CHECK_VOID();
-        rsp_cache_body_.reset();
     }
     onResponseComplete();
 }
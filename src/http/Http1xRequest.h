@@ -64,13 +64,11 @@ private:
     bool processHttpCache();
     
     void onCacheComplete();
+    void onIncomingComplete();
     void onRequestComplete();
     
 private:
     std::unique_ptr<H1xStream> stream_;
-    
-    int                     rsp_cache_status_ = 0;
-    KMBuffer::Ptr           rsp_cache_body_;
 };
 
 KUMA_NS_END
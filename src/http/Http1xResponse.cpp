@@ -69,6 +69,16 @@ KMError Http1xResponse::setSslFlags(uint32_t ssl_flags)
     return stream_->setSslFlags(ssl_flags);
 }
 
+KMError Http1xResponse::setSendBufferWatermarks(size_t high, size_t low)
+{
+    return stream_->setSendBufferWatermarks(high, low);
+}
+
+KMError Http1xResponse::setZeroCopyThreshold(size_t threshold)
+{
+    return stream_->setZeroCopyThreshold(threshold);
+}
+
 KMError Http1xResponse::attachFd(SOCKET_FD fd, const KMBuffer *init_buf)
 {
     setState(State::RECVING_REQUEST);
@@ -112,6 +122,12 @@ KMError Http1xResponse::sendResponse(int status_code, const std::string& desc, c
     return stream_->sendResponse(status_code, desc, ver);
 }
 
+KMError Http1xResponse::sendTemplateResponse(const HttpHeaderTemplate::Impl &tpl, size_t content_length)
+{
+    KM_INFOXTRACE("sendTemplateResponse, status_code=" << tpl.getStatusCode());
+    return stream_->sendResponse(tpl, content_length);
+}
+
 bool Http1xResponse::canSendBody() const
 {
     return stream_->canSendData() && getState() == State::SENDING_RESPONSE;
@@ -40,10 +40,13 @@ public:
     ~Http1xResponse();
     
     KMError setSslFlags(uint32_t ssl_flags) override;
+    KMError setSendBufferWatermarks(size_t high, size_t low) override;
+    KMError setZeroCopyThreshold(size_t threshold) override;
     KMError attachFd(SOCKET_FD fd, const KMBuffer *init_buf) override;
     KMError attachSocket(TcpSocket::Impl&& tcp, HttpParser::Impl&& parser, const KMBuffer *init_buf) override;
     KMError addHeader(std::string name, std::string value) override;
     KMError sendResponse(int status_code, const std::string& desc, const std::string& ver) override;
+    KMError sendTemplateResponse(const HttpHeaderTemplate::Impl &tpl, size_t content_length) override;
     int sendBody(const void* data, size_t len) override;
     int sendBody(const KMBuffer &buf) override;
     void reset() override; // reset for connection reuse
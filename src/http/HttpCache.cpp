@@ -20,49 +20,528 @@
  */
 
 #include "HttpCache.h"
+#include "httputils.h"
 #include "libkev/src/utils/kmtrace.h"
 #include "libkev/src/utils/utils.h"
 
+#include <algorithm>
+#include <climits>
+
 KUMA_NS_USING
 
-bool HttpCache::getCache(const std::string &key, int &status_code, HeaderVector &headers, KMBuffer &body)
+namespace {
+    // the memory of list node, index node and the strings besides their data
+    const size_t kEntryOverhead = 128;
+    const size_t kHeaderOverhead = 2 * sizeof(std::string);
+    const int64_t kSweepIntervalMs = 1000;
+    // how long an expired record with validators is kept for revalidation
+    const int kMaxStaleSeconds = 3600;
+    // the bodies not smaller than this are stored in disk tier if it is enabled
+    const size_t kMinDiskBodySize = 64 * 1024;
+    
+    const std::string* findHeader(const HeaderVector &headers, const std::string &name)
+    {
+        for (auto &kv : headers) {
+            if (kev::is_equal(kv.first, name)) {
+                return &kv.second;
+            }
+        }
+        return nullptr;
+    }
+    
+    int parseDeltaSeconds(const std::string &str)
+    {
+        auto *s = str.c_str();
+        if (*s == '"') {
+            ++s;
+        }
+        if (*s < '0' || *s > '9') {
+            return -1;
+        }
+        auto v = strtoll(s, nullptr, 10);
+        return v > INT_MAX ? INT_MAX : static_cast<int>(v);
+    }
+    
+    struct CacheControl
+    {
+        bool no_store = false;
+        bool no_cache = false;
+        bool is_private = false;
+        int max_age = -1;
+        int s_maxage = -1;
+        // the fields listed by qualified no-cache or private, they are not stored
+        std::vector<std::string> private_fields;
+    };
+    
+    /* add a field name of the list of qualified no-cache or private, the list is split
+     * into several tokens by ','. return true if the quoted list continues in next token
+     */
+    bool addFieldName(std::string name, bool continued, std::vector<std::string> &fields)
+    {
+        bool quoted = continued;
+        if (!name.empty() && name.front() == '"') {
+            name.erase(0, 1);
+            quoted = true;
+        }
+        if (!name.empty() && name.back() == '"') {
+            name.pop_back();
+            quoted = false;
+        }
+        kev::trim_left(name, ' ');
+        kev::trim_right(name, ' ');
+        if (!name.empty()) {
+            fields.emplace_back(std::move(name));
+        }
+        return quoted;
+    }
+    
+    CacheControl parseCacheControl(const HeaderVector &headers)
+    {
+        CacheControl cc;
+        for (auto &kv : headers) {
+            if (kev::is_equal(kv.first, strCacheControl)) {
+                bool in_fields = false;
+                kev::for_each_token(kv.second, ',', [&cc, &in_fields] (std::string &d) {
+                    if (in_fields) {
+                        in_fields = addFieldName(d, true, cc.private_fields);
+                    } else if (kev::is_equal(d, "no-store")) {
+                        cc.no_store = true;
+                    } else if (kev::is_equal(d, "no-cache")) {
+                        cc.no_cache = true;
+                    } else if (kev::is_equal(d, "no-cache=", 9)) {
+                        in_fields = addFieldName(d.substr(9), false, cc.private_fields);
+                    } else if (kev::is_equal(d, "private")) {
+                        cc.is_private = true;
+                    } else if (kev::is_equal(d, "private=", 8)) {
+                        in_fields = addFieldName(d.substr(8), false, cc.private_fields);
+                    } else if (kev::is_equal(d, "max-age=", 8)) {
+                        cc.max_age = parseDeltaSeconds(d.substr(8));
+                    } else if (kev::is_equal(d, "s-maxage=", 9)) {
+                        cc.s_maxage = parseDeltaSeconds(d.substr(9));
+                    }
+                    return true;
+                });
+            }
+        }
+        return cc;
+    }
+    
+    // remove the fields which must not be served without revalidation
+    void removePrivateFields(HeaderVector &headers)
+    {
+        auto cc = parseCacheControl(headers);
+        if (cc.private_fields.empty()) {
+            return;
+        }
+        headers.erase(std::remove_if(headers.begin(), headers.end(), [&cc] (const KeyValuePair &kv) {
+            return std::any_of(cc.private_fields.begin(), cc.private_fields.end(), [&kv] (const std::string &name) {
+                return kev::is_equal(kv.first, name);
+            });
+        }), headers.end());
+    }
+}
+
+const std::string* HttpCache::Response::getHeader(const std::string &name) const
+{
+    return findHeader(headers, name);
+}
+
+std::shared_ptr<HttpCache::Response> HttpCache::createResponse(int status_code, HeaderVector &&headers, const KMBuffer &body)
+{
+    auto rsp = std::make_shared<Response>();
+    rsp->status_code = status_code;
+    for (auto it = headers.begin(); it != headers.end(); ) {
+        if (kev::is_equal(it->first, "Age")) {
+            rsp->age = std::max(parseDeltaSeconds(it->second), 0);
+            it = headers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    rsp->headers = std::move(headers);
+    // shares the storage of body
+    rsp->body = body;
+    rsp->receive_time = steady_clock::now();
+    return rsp;
+}
+
+void HttpCache::CacheRecord::setResponse(ResponsePtr rsp, int max_age)
+{
+    response = std::move(rsp);
+    this->max_age = max_age;
+    auto *value = response->getHeader("ETag");
+    etag = value ? *value : "";
+    value = response->getHeader("Last-Modified");
+    last_modified = value ? *value : "";
+    expire_time = response->receive_time;
+    if (max_age > response->age) {
+        expire_time += seconds(max_age - response->age);
+    }
+}
+
+bool HttpCache::CacheRecord::matchVary(const HeaderVector &req_headers) const
+{
+    for (auto &kv : vary) {
+        auto *value = findHeader(req_headers, kv.first);
+        if (value ? *value != kv.second : !kv.second.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t HttpCache::CacheRecord::cost(const std::string &key) const
+{
+    size_t c = kEntryOverhead + 2 * key.size() + etag.size() + last_modified.size();
+    for (auto &kv : response->headers) {
+        c += kHeaderOverhead + kv.first.size() + kv.second.size();
+    }
+    for (auto &kv : vary) {
+        c += kHeaderOverhead + kv.first.size() + kv.second.size();
+    }
+    return response->mapped ? c : c + response->body.chainLength();
+}
+
+HttpCache::Shard& HttpCache::getShard(const std::string &key)
 {
-    std::lock_guard<std::mutex> g(mutex_);
-    auto it = caches_.find(key);
-    if (it == caches_.end()) {
+    return shards_[std::hash<std::string>()(key) % kNumShards];
+}
+
+void HttpCache::removeEntry(Shard &shard, EntryList::iterator it)
+{
+    shard.bytes -= it->cost;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+void HttpCache::evict(Shard &shard, size_t budget)
+{
+    while (shard.bytes > budget && !shard.lru.empty()) {
+        auto it = std::prev(shard.lru.end());
+        KM_INFOTRACE("HttpCache::evict, key=" << it->key << ", cost=" << it->cost);
+        removeEntry(shard, it);
+        ++shard.stats.evictions;
+    }
+}
+
+void HttpCache::checkSweep(time_point<steady_clock> now)
+{
+    auto now_ms = duration_cast<milliseconds>(now.time_since_epoch()).count();
+    auto next_time = next_sweep_time_.load(std::memory_order_relaxed);
+    if (now_ms < next_time) {
+        return;
+    }
+    if (next_sweep_time_.compare_exchange_strong(next_time, now_ms + kSweepIntervalMs)) {
+        sweepExpired();
+    }
+}
+
+bool HttpCache::isDiscardable(const CacheRecord &record, time_point<steady_clock> now) const
+{
+    if (record.isFresh(now)) {
         return false;
     }
+    return !record.hasValidators() || now > record.expire_time + seconds(kMaxStaleSeconds);
+}
+
+HttpCache::ResponsePtr HttpCache::getCache(const std::string &key, const HeaderVector &req_headers)
+{
     auto now_time = steady_clock::now();
-    if (now_time > it->second.expire_time) {
-        caches_.erase(it);
-        return false;
+    checkSweep(now_time);
+    auto &shard = getShard(key);
+    std::unique_lock<std::mutex> ul(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end() && disk_) {
+        ul.unlock();
+        loadFromDisk(key);
+        ul.lock();
+        it = shard.index.find(key);
     }
-    status_code = it->second.status_code;
-    headers = it->second.headers;
-    body = *(it->second.body.get());
-    auto age = duration_cast<std::chrono::seconds>(now_time - it->second.receive_time).count();
-    headers.emplace_back("Age", std::to_string(age));
-    return true;
+    if (it == shard.index.end()) {
+        ++shard.stats.misses;
+        return nullptr;
+    }
+    auto entry = it->second;
+    if (!entry->record.isFresh(now_time)) {
+        if (isDiscardable(entry->record, now_time)) {
+            removeEntry(shard, entry);
+            ++shard.stats.expirations;
+        }
+        ++shard.stats.misses;
+        return nullptr;
+    }
+    if (!entry->record.matchVary(req_headers)) {
+        ++shard.stats.misses;
+        return nullptr;
+    }
+    ++shard.stats.hits;
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+    return entry->record.response;
 }
-/*
-void HttpCache::setCache(const std::string &key, int status_code, HeaderVector headers, const uint8_t *body, size_t body_size)
+
+bool HttpCache::getValidators(const std::string &key, const HeaderVector &req_headers,
+                              std::string &etag, std::string &last_modified)
 {
-    HttpBody b;
-    if (body && body_size > 0) {
-        b.assign(body, body + body_size);
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        return false;
+    }
+    auto const &record = it->second->record;
+    if (!record.hasValidators() || !record.matchVary(req_headers)) {
+        return false;
     }
-    setCache(key, status_code, std::move(headers), std::move(b));
+    etag = record.etag;
+    last_modified = record.last_modified;
+    return true;
 }
-*/
-void HttpCache::setCache(const std::string &key, int status_code, HeaderVector headers, KMBuffer &body)
+
+void HttpCache::setCache(const std::string &key, const HeaderVector &req_headers,
+                         int status_code, HeaderVector headers, KMBuffer &body)
 {
+    if (!isStorable(status_code, headers)) {
+        return;
+    }
     auto max_age = getMaxAgeOfCache(headers);
     KM_INFOTRACE("HttpCache::setCache, key="<<key<<", max_age="<<max_age<<", body="<<body.chainLength());
-    if (max_age <= 0) {
+    if (max_age < 0) {
+        return;
+    }
+    // the pseudo headers of HTTP/2, the record is shared with HTTP/1.x requests
+    headers.erase(std::remove_if(headers.begin(), headers.end(), [] (const KeyValuePair &kv) {
+        return !kv.first.empty() && kv.first[0] == ':';
+    }), headers.end());
+    removePrivateFields(headers);
+    HeaderVector vary;
+    for (auto &kv : headers) {
+        if (kev::is_equal(kv.first, "Vary")) {
+            kev::for_each_token(kv.second, ',', [&vary, &req_headers] (std::string &name) {
+                auto *value = findHeader(req_headers, name);
+                vary.emplace_back(name, value ? *value : "");
+                return true;
+            });
+        }
+    }
+    auto rsp = createResponse(status_code, std::move(headers), body);
+    auto receive_time = rsp->receive_time;
+    CacheRecord record{rsp, std::move(vary), max_age};
+    if (!record.isFresh(receive_time) && !record.hasValidators()) {
         return;
     }
-    std::lock_guard<std::mutex> g(mutex_);
-    caches_[key] = {status_code, std::move(headers), body, max_age};
+    if (disk_) {
+        if (rsp->body.chainLength() >= kMinDiskBodySize) {
+            // the record is not shared yet, its body can be replaced by the mapped one
+            writeToDisk(key, rsp, record.vary, max_age);
+        } else {
+            disk_->remove(key);
+        }
+    }
+    auto budget = capacity_.load(std::memory_order_relaxed) / kNumShards;
+    auto cost = record.cost(key);
+    if (cost > budget) {
+        // larger than the share of one shard
+        return;
+    }
+    checkSweep(receive_time);
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        removeEntry(shard, it->second);
+    }
+    shard.lru.push_front(Entry{key, std::move(record), cost});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += cost;
+    evict(shard, budget);
+}
+
+HttpCache::ResponsePtr HttpCache::updateCache(const std::string &key, const HeaderVector &rsp_headers)
+{
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        return nullptr;
+    }
+    auto entry = it->second;
+    auto &record = entry->record;
+    auto const &stored = *record.response;
+    auto isUpdated = [&rsp_headers] (const std::string &name) {
+        if (kev::is_equal(name, strContentLength) || kev::is_equal(name, strTransferEncoding)) {
+            return false;
+        }
+        return findHeader(rsp_headers, name) != nullptr;
+    };
+    HeaderVector headers;
+    for (auto &kv : stored.headers) {
+        if (!isUpdated(kv.first)) {
+            headers.emplace_back(kv);
+        }
+    }
+    for (auto &kv : rsp_headers) {
+        if (isUpdated(kv.first)) {
+            headers.emplace_back(kv);
+        }
+    }
+    auto max_age = getMaxAgeOfCache(headers);
+    if (max_age < 0) {
+        removeEntry(shard, entry);
+        if (disk_) {
+            disk_->remove(key);
+        }
+        return nullptr;
+    }
+    KM_INFOTRACE("HttpCache::updateCache, key="<<key<<", max_age="<<max_age);
+    removePrivateFields(headers);
+    auto rsp = createResponse(stored.status_code, std::move(headers), stored.body);
+    rsp->mapped = stored.mapped;
+    record.setResponse(rsp, max_age);
+    ++shard.stats.revalidations;
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+    
+    auto cost = record.cost(key);
+    shard.bytes = shard.bytes - entry->cost + cost;
+    entry->cost = cost;
+    evict(shard, capacity_.load(std::memory_order_relaxed) / kNumShards);
+    return rsp;
+}
+
+void HttpCache::writeToDisk(const std::string &key, const std::shared_ptr<Response> &rsp,
+                            const HeaderVector &vary, int max_age)
+{
+    HttpDiskCache::Record disk_record;
+    disk_record.status_code = rsp->status_code;
+    disk_record.headers = rsp->headers;
+    disk_record.vary = vary;
+    disk_record.max_age = max_age;
+    disk_record.age = rsp->age;
+    disk_record.write_time = time(nullptr);
+    disk_record.body = rsp->body;
+    if (disk_->write(key, disk_record)) {
+        rsp->body = std::move(disk_record.body);
+        rsp->mapped = true;
+    } else {
+        disk_->remove(key);
+    }
+}
+
+bool HttpCache::loadFromDisk(const std::string &key)
+{
+    HttpDiskCache::Record disk_record;
+    if (!disk_->read(key, disk_record)) {
+        return false;
+    }
+    auto rsp = std::make_shared<Response>();
+    rsp->status_code = disk_record.status_code;
+    rsp->headers = std::move(disk_record.headers);
+    rsp->body = std::move(disk_record.body);
+    rsp->mapped = true;
+    // the time on disk is lived through as Age
+    auto elapsed = time(nullptr) - disk_record.write_time;
+    auto age = static_cast<int64_t>(disk_record.age) + (elapsed > 0 ? elapsed : 0);
+    rsp->age = age > INT_MAX ? INT_MAX : static_cast<int>(age);
+    rsp->receive_time = steady_clock::now();
+    auto receive_time = rsp->receive_time;
+    CacheRecord record{std::move(rsp), std::move(disk_record.vary), disk_record.max_age};
+    if (isDiscardable(record, receive_time)) {
+        disk_->remove(key);
+        return false;
+    }
+    auto budget = capacity_.load(std::memory_order_relaxed) / kNumShards;
+    auto cost = record.cost(key);
+    if (cost > budget) {
+        return false;
+    }
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> g(shard.mutex);
+    if (shard.index.find(key) != shard.index.end()) {
+        return true;
+    }
+    shard.lru.push_front(Entry{key, std::move(record), cost});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += cost;
+    ++shard.stats.disk_hits;
+    evict(shard, budget);
+    return true;
+}
+
+size_t HttpCache::getMaxRecordSize() const
+{
+    auto max_size = capacity_.load(std::memory_order_relaxed) / kNumShards;
+    if (disk_) {
+        max_size = std::max(max_size, disk_->getMaxRecordSize());
+    }
+    return max_size;
+}
+
+KMError HttpCache::setDiskTier(const std::string &dir, size_t capacity)
+{
+    if (dir.empty() || capacity == 0) {
+        disk_.reset();
+        return KMError::NOERR;
+    }
+    std::unique_ptr<HttpDiskCache> disk(new HttpDiskCache());
+    auto ret = disk->open(dir, capacity);
+    if (ret != KMError::NOERR) {
+        return ret;
+    }
+    disk_ = std::move(disk);
+    return KMError::NOERR;
+}
+
+void HttpCache::setCapacity(size_t bytes)
+{
+    capacity_ = bytes;
+    auto budget = bytes / kNumShards;
+    for (auto &shard : shards_) {
+        std::lock_guard<std::mutex> g(shard.mutex);
+        evict(shard, budget);
+    }
+}
+
+HttpCache::Stats HttpCache::getStats() const
+{
+    Stats stats;
+    for (auto &shard : shards_) {
+        std::lock_guard<std::mutex> g(shard.mutex);
+        stats.hits += shard.stats.hits;
+        stats.misses += shard.stats.misses;
+        stats.evictions += shard.stats.evictions;
+        stats.expirations += shard.stats.expirations;
+        stats.revalidations += shard.stats.revalidations;
+        stats.disk_hits += shard.stats.disk_hits;
+        stats.entries += shard.lru.size();
+        stats.bytes += shard.bytes;
+    }
+    if (disk_) {
+        stats.disk_bytes = disk_->getBytes();
+    }
+    return stats;
+}
+
+void HttpCache::clear()
+{
+    for (auto &shard : shards_) {
+        std::lock_guard<std::mutex> g(shard.mutex);
+        shard.lru.clear();
+        shard.index.clear();
+        shard.bytes = 0;
+    }
+}
+
+void HttpCache::sweepExpired()
+{
+    auto &shard = shards_[sweep_shard_.fetch_add(1, std::memory_order_relaxed) % kNumShards];
+    auto now_time = steady_clock::now();
+    std::lock_guard<std::mutex> g(shard.mutex);
+    for (auto it = shard.lru.begin(); it != shard.lru.end(); ) {
+        auto cur = it++;
+        if (isDiscardable(cur->record, now_time)) {
+            removeEntry(shard, cur);
+            ++shard.stats.expirations;
+        }
+    }
 }
 
 HttpCache& HttpCache::instance()
@@ -71,48 +550,77 @@ HttpCache& HttpCache::instance()
     return inst;
 }
 
-bool HttpCache::isCacheable(const std::string &method, const HeaderVector &headers)
+bool HttpCache::isCacheable(const std::string &method, const HeaderVector &req_headers)
 {
-    if (kev::is_equal(method, "POST") || kev::is_equal(method, "PUT")) {
+    if (!kev::is_equal(method, "GET")) {
         return false;
     }
-    bool cacheable = true;
-    for (auto &kv : headers) {
-        if (kev::is_equal(kv.first, strCacheControl)) {
-            auto &directives = kv.second;
-            kev::for_each_token(directives, ',', [&cacheable] (std::string &d) {
-                if (kev::is_equal(d, "no-store") || kev::is_equal(d, "no-cache")) {
-                    cacheable = false;
-                    return false;
-                }
-                return true;
-            });
-        } else if (kev::is_equal(kv.first, strUpgrade)) {
+    auto cc = parseCacheControl(req_headers);
+    if (cc.no_store || cc.no_cache) {
+        return false;
+    }
+    for (auto &kv : req_headers) {
+        auto &name = kv.first;
+        if (kev::is_equal(name, "Pragma")) {
+            if (kev::contains_token(kv.second, "no-cache", ',')) {
+                return false;
+            }
+        } else if (kev::is_equal(name, strUpgrade) ||
+                   kev::is_equal(name, "Authorization") ||
+                   kev::is_equal(name, "Range") ||
+                   kev::is_equal(name, "If-", 3)) {
+            // the caller handles the partial or conditional response by itself
             return false;
         }
     }
-    return cacheable;
+    return true;
+}
+
+bool HttpCache::isStorable(int status_code, const HeaderVector &rsp_headers)
+{
+    switch (status_code) {
+        case 200: case 203: case 204: case 300: case 301: case 308: case 404: case 410:
+            break;
+        default:
+            return false;
+    }
+    // the cache is shared by all the requests of process
+    if (parseCacheControl(rsp_headers).is_private) {
+        return false;
+    }
+    auto *vary = findHeader(rsp_headers, "Vary");
+    return !vary || !kev::contains_token(*vary, "*", ',');
 }
 
 int HttpCache::getMaxAgeOfCache(const HeaderVector &headers)
 {
-    int max_age = 0;
-    for (auto &kv : headers) {
-        if (kev::is_equal(kv.first, strCacheControl)) {
-            auto &directives = kv.second;
-            kev::for_each_token(directives, ',', [&max_age] (std::string &d) {
-                if (kev::is_equal(d, "no-store") || kev::is_equal(d, "no-cache")) {
-                    return false;
-                }
-                auto p = d.find("max-age=");
-                if (p != std::string::npos) {
-                    auto s = d.substr(p + 8);
-                    max_age = std::stoi(s);
-                    return false;
-                }
-                return true;
-            });
+    auto cc = parseCacheControl(headers);
+    if (cc.no_store || cc.is_private) {
+        return -1;
+    }
+    if (cc.no_cache) {
+        return 0;
+    }
+    if (cc.s_maxage >= 0) {
+        return cc.s_maxage;
+    }
+    if (cc.max_age >= 0) {
+        return cc.max_age;
+    }
+    auto *expires = findHeader(headers, "Expires");
+    if (expires) {
+        time_t expire_time = 0;
+        if (!parseHttpDate(*expires, expire_time)) {
+            // invalid date represents a time in the past
+            return 0;
+        }
+        time_t date_time = 0;
+        auto *date = findHeader(headers, "Date");
+        if (!date || !parseHttpDate(*date, date_time)) {
+            date_time = time(nullptr);
         }
+        auto delta = expire_time - date_time;
+        return delta <= 0 ? 0 : delta > INT_MAX ? INT_MAX : static_cast<int>(delta);
     }
-    return max_age;
+    return 0;
 }
@@ -24,26 +24,100 @@
 
 #include "httpdefs.h"
 #include "kmbuffer.h"
+#include "kmapi.h"
+#include "HttpDiskCache.h"
 
 #include <memory>
-#include <map>
+#include <list>
+#include <unordered_map>
 #include <vector>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 using namespace std::chrono;
 
 KUMA_NS_BEGIN
 
+/* HttpCache is split into shards by the hash of key, each shard has its own lock,
+ * LRU list and a share of the byte budget. the expired records are removed by a
+ * sweep of one shard per second, which runs on the thread that accesses the cache.
+ * the expired records with ETag or Last-Modified are kept a while for revalidation.
+ *
+ * the instance is shared by all the requests of process, so it follows the rules of
+ * shared cache: s-maxage takes precedence over max-age, the response with private is
+ * not stored, the fields listed by qualified no-cache or private are not stored, and
+ * the request with Authorization is not cached. a stale response is never served
+ * without a successful revalidation, which satisfies must-revalidate and
+ * proxy-revalidate
+ */
 class HttpCache
 {
 public:
-    bool getCache(const std::string &key, int &status_code, HeaderVector &headers, KMBuffer &body);
-    //void setCache(const std::string &key, int status_code, HeaderVector headers, const uint8_t *body, size_t body_size);
-    void setCache(const std::string &key, int status_code, HeaderVector headers, KMBuffer &body);
+    using Stats = HttpCacheStats;
+    
+    /* the immutable snapshot of a stored response, it is shared by the cache and the
+     * requests that hit it, so a hit copies neither headers nor body. a 304 replaces
+     * the snapshot instead of modifying it
+     */
+    struct Response
+    {
+        int status_code = 0;
+        // without the Age header, it is computed by getAge when the response is used
+        HeaderVector headers;
+        KMBuffer body;
+        // the Age of the response when it is received
+        int age = 0;
+        time_point<steady_clock> receive_time;
+        // the body refers to the disk tier, it is not charged to the byte budget
+        bool mapped = false;
+        
+        const std::string* getHeader(const std::string &name) const;
+        int64_t getAge(time_point<steady_clock> now) const
+        {
+            return age + duration_cast<seconds>(now - receive_time).count();
+        }
+    };
+    using ResponsePtr = std::shared_ptr<const Response>;
+    
+    /* find a fresh response of key which matches req_headers on its Vary headers */
+    ResponsePtr getCache(const std::string &key, const HeaderVector &req_headers);
+    /* the validators of the stored response of key, to make a conditional request.
+     * return false if there is no such response or it has no validator
+     */
+    bool getValidators(const std::string &key, const HeaderVector &req_headers,
+                       std::string &etag, std::string &last_modified);
+    void setCache(const std::string &key, const HeaderVector &req_headers,
+                  int status_code, HeaderVector headers, KMBuffer &body);
+    /* refresh the stored response of key with the headers of a 304 response,
+     * and return the refreshed response
+     */
+    ResponsePtr updateCache(const std::string &key, const HeaderVector &rsp_headers);
+    
+    /* the total bytes of all shards, 0 disables the cache */
+    void setCapacity(size_t bytes);
+    size_t getCapacity() const { return capacity_; }
+    /* the max size of a response can be stored */
+    size_t getMaxRecordSize() const;
+    /* store the bodies not smaller than 64KB in the segment files of dir, up to capacity
+     * bytes. the records in dir are loaded, so a restarted process keeps its cache.
+     * empty dir or 0 capacity disables the disk tier. it should be set before any request.
+     * setCache copies and hashes the body into the mapping in the calling thread, and the
+     * first read of a record loaded from dir hashes its body, so both block the event loop
+     * for a time linear in the body size
+     */
+    KMError setDiskTier(const std::string &dir, size_t capacity);
+    Stats getStats() const;
+    void clear();
+    /* remove the expired records of the next shard */
+    void sweepExpired();
     
     static HttpCache& instance();
-    static bool isCacheable(const std::string &method, const HeaderVector &headers);
+    static bool isCacheable(const std::string &method, const HeaderVector &req_headers);
+    static bool isStorable(int status_code, const HeaderVector &rsp_headers);
+    /* the freshness lifetime in seconds from s-maxage, max-age or Expires. 0 if the
+     * response must be revalidated before use, -1 if it must not be stored, e.g. private
+     */
     static int getMaxAgeOfCache(const HeaderVector &headers);
     
 protected:
@@ -54,40 +128,69 @@ protected:
     {
     public:
         CacheRecord() = default;
-        CacheRecord(int code, HeaderVector &&h, KMBuffer &b, int max_age)
-            : status_code(code), headers(std::move(h)), body(b.clone()), max_age(max_age)
-        {
-            receive_time = steady_clock::now();
-            expire_time = receive_time + seconds(max_age);
-        }
-        CacheRecord(CacheRecord &&other)
+        CacheRecord(ResponsePtr rsp, HeaderVector &&vary, int max_age)
+            : vary(std::move(vary))
         {
-            headers = std::move(other.headers);
-            body = std::move(other.body);
-            receive_time = std::move(other.receive_time);
-            expire_time = std::move(other.expire_time);
+            setResponse(std::move(rsp), max_age);
         }
-        CacheRecord& operator=(CacheRecord &&other)
-        {
-            if (this != &other) {
-                headers = std::move(other.headers);
-                body = std::move(other.body);
-                receive_time = std::move(other.receive_time);
-                expire_time = std::move(other.expire_time);
-            }
-            return *this;
-        }
-        int status_code = 0;
-        HeaderVector headers;
-        KMBuffer::Ptr body;
+        CacheRecord(CacheRecord &&other) = default;
+        CacheRecord& operator=(CacheRecord &&other) = default;
+        
+        /* replace the response and restart the freshness lifetime */
+        void setResponse(ResponsePtr rsp, int max_age);
+        bool isFresh(time_point<steady_clock> now) const { return now < expire_time; }
+        bool hasValidators() const { return !etag.empty() || !last_modified.empty(); }
+        bool matchVary(const HeaderVector &req_headers) const;
+        /* the memory charged to the byte budget */
+        size_t cost(const std::string &key) const;
+        
+        ResponsePtr response;
+        // the request headers selected by Vary
+        HeaderVector vary;
+        std::string etag;
+        std::string last_modified;
         int max_age = 0;
-        time_point<steady_clock> receive_time;
         time_point<steady_clock> expire_time;
     };
-    using CacheMap = std::map<std::string, CacheRecord>;
     
-    CacheMap caches_;
-    std::mutex mutex_;
+    struct Entry
+    {
+        std::string     key;
+        CacheRecord     record;
+        size_t          cost = 0;
+    };
+    using EntryList = std::list<Entry>;
+    
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        // the most recently used is at front
+        EntryList lru;
+        std::unordered_map<std::string, EntryList::iterator> index;
+        size_t bytes = 0;
+        Stats stats;
+    };
+    
+    Shard& getShard(const std::string &key);
+    void removeEntry(Shard &shard, EntryList::iterator it);
+    void evict(Shard &shard, size_t budget);
+    void checkSweep(time_point<steady_clock> now);
+    bool isDiscardable(const CacheRecord &record, time_point<steady_clock> now) const;
+    /* the Age header is taken off headers */
+    static std::shared_ptr<Response> createResponse(int status_code, HeaderVector &&headers, const KMBuffer &body);
+    void writeToDisk(const std::string &key, const std::shared_ptr<Response> &rsp,
+                     const HeaderVector &vary, int max_age);
+    bool loadFromDisk(const std::string &key);
+    
+protected:
+    static const size_t kNumShards = 16;
+    static const size_t kDefaultCapacity = 64 * 1024 * 1024;
+    
+    Shard shards_[kNumShards];
+    std::atomic<size_t> capacity_{ kDefaultCapacity };
+    std::atomic<int64_t> next_sweep_time_{ 0 };
+    std::atomic<size_t> sweep_shard_{ 0 };
+    std::unique_ptr<HttpDiskCache> disk_;
 };
 
 KUMA_NS_END
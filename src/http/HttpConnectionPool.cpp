@@ -0,0 +1,226 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "HttpConnectionPool.h"
+#include "libkev/src/utils/kmtrace.h"
+
+using namespace kuma;
+
+std::mutex HttpConnectionPool::pools_mutex_;
+std::map<kev::EventLoop::Impl*, HttpConnectionPool::Ptr> HttpConnectionPool::pools_;
+HttpConnectionPool::Config HttpConnectionPool::config_;
+//////////////////////////////////////////////////////////////////////////
+
+HttpConnectionPool::HttpConnectionPool(const EventLoopPtr &loop)
+: loop_(loop), timer_(loop->getTimerMgr())
+{
+    loop_token_.eventLoop(loop);
+    // release the idle connections when loop exit
+    loop->appendObserver([this] (kev::LoopActivity acti) {
+        onLoopActivity(acti);
+    }, &loop_token_);
+}
+
+HttpConnectionPool::~HttpConnectionPool()
+{
+    cleanup();
+}
+
+HttpConnectionPool::TcpSocketPtr HttpConnectionPool::getConnection(const std::string &key)
+{
+    auto config = getConfig();
+    auto now = std::chrono::steady_clock::now();
+    removeExpired(config, now);
+    auto it = idle_conns_.begin();
+    while (it != idle_conns_.end()) {
+        if (it->key != key) {
+            ++it;
+            continue;
+        }
+        auto tcp = std::move(it->tcp);
+        it = idle_conns_.erase(it);
+        if (isAlive(*tcp)) {
+            tcp->setReadCallback(nullptr);
+            KM_INFOTRACE("HttpConnectionPool::getConnection, reuse, key=" << key << ", fd=" << tcp->getFd());
+            return tcp;
+        }
+        KM_INFOTRACE("HttpConnectionPool::getConnection, stale connection, key=" << key);
+    }
+    return nullptr;
+}
+
+void HttpConnectionPool::addConnection(const std::string &key, TcpSocketPtr tcp)
+{
+    if (!tcp || !tcp->isReady()) {
+        return;
+    }
+    auto config = getConfig();
+    if (config.max_idle == 0 || config.max_idle_per_host == 0 || config.idle_timeout_ms == 0) {
+        return; // the connection is closed
+    }
+    auto now = std::chrono::steady_clock::now();
+    removeExpired(config, now);
+    // drop the least recently used ones to make room
+    size_t count = 0;
+    for (auto it = idle_conns_.begin(); it != idle_conns_.end(); ) {
+        if (it->key == key && ++count >= config.max_idle_per_host) {
+            it = idle_conns_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (idle_conns_.size() >= config.max_idle) {
+        idle_conns_.pop_back();
+    }
+    // nothing is expected on idle connection, it is checked when readable
+    auto *ptr = tcp.get();
+    tcp->setReadCallback([this, ptr] (KMError) {
+        onIdleReceive(ptr);
+    });
+    idle_conns_.push_front({key, std::move(tcp), now});
+    scheduleTimer(config, now);
+}
+
+bool HttpConnectionPool::isAlive(TcpSocket::Impl &tcp)
+{
+    if (!tcp.isReady()) {
+        return false;
+    }
+    // the server sends nothing until next request, data or EOF means the connection
+    // is being closed by server
+    uint8_t c = 0;
+    KMError err = KMError::NOERR;
+    auto ret = tcp.receive(&c, 1, &err);
+    return ret == 0 && err == KMError::NOERR && tcp.isReady();
+}
+
+void HttpConnectionPool::onIdleReceive(TcpSocket::Impl *tcp)
+{
+    if (!isAlive(*tcp)) {
+        // it is removed from the list on next check
+        tcp->close();
+    }
+}
+
+void HttpConnectionPool::removeExpired(const Config &config, TimePoint now)
+{
+    auto timeout = std::chrono::milliseconds(config.idle_timeout_ms);
+    for (auto it = idle_conns_.begin(); it != idle_conns_.end(); ) {
+        if (!it->tcp->isReady() || now - it->idle_since >= timeout) {
+            it = idle_conns_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (idle_conns_.size() > config.max_idle) {
+        idle_conns_.pop_back();
+    }
+}
+
+void HttpConnectionPool::scheduleTimer(const Config &config, TimePoint now)
+{
+    if (idle_conns_.empty()) {
+        if (timer_scheduled_) {
+            timer_scheduled_ = false;
+            timer_.cancel();
+        }
+        return;
+    }
+    if (timer_scheduled_) {
+        return; // the pending timer is due earlier
+    }
+    // the oldest connection is at back
+    auto expire_time = idle_conns_.back().idle_since + std::chrono::milliseconds(config.idle_timeout_ms);
+    auto delay_ms = expire_time > now ?
+        std::chrono::duration_cast<std::chrono::milliseconds>(expire_time - now).count() : 0;
+    timer_scheduled_ = timer_.schedule(static_cast<uint32_t>(delay_ms) + 1, kev::Timer::Mode::ONE_SHOT, [this] {
+        onTimer();
+    });
+}
+
+void HttpConnectionPool::onTimer()
+{
+    timer_scheduled_ = false;
+    auto config = getConfig();
+    auto now = std::chrono::steady_clock::now();
+    removeExpired(config, now);
+    scheduleTimer(config, now);
+}
+
+void HttpConnectionPool::onLoopActivity(kev::LoopActivity acti)
+{
+    if (acti == kev::LoopActivity::EXIT) {
+        KM_INFOTRACE("HttpConnectionPool::onLoopActivity, loop exit, idle=" << idle_conns_.size());
+        cleanup();
+        Ptr self; // destroyed after the lock is released
+        std::lock_guard<std::mutex> g(pools_mutex_);
+        for (auto it = pools_.begin(); it != pools_.end(); ++it) {
+            if (it->second.get() == this) {
+                self = std::move(it->second);
+                pools_.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+void HttpConnectionPool::cleanup()
+{
+    loop_token_.reset();
+    if (timer_scheduled_) {
+        timer_scheduled_ = false;
+        timer_.cancel();
+    }
+    idle_conns_.clear();
+}
+
+HttpConnectionPool::Ptr HttpConnectionPool::getPool(const EventLoopPtr &loop, bool create)
+{
+    if (!loop) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> g(pools_mutex_);
+    auto it = pools_.find(loop.get());
+    if (it != pools_.end()) {
+        if (it->second->loop_.lock() == loop) {
+            return it->second;
+        }
+        pools_.erase(it); // the loop was destroyed without exit
+    }
+    if (!create) {
+        return nullptr;
+    }
+    auto pool = std::make_shared<HttpConnectionPool>(loop);
+    pools_[loop.get()] = pool;
+    return pool;
+}
+
+void HttpConnectionPool::setConfig(const Config &config)
+{
+    std::lock_guard<std::mutex> g(pools_mutex_);
+    config_ = config;
+}
+
+HttpConnectionPool::Config HttpConnectionPool::getConfig()
+{
+    std::lock_guard<std::mutex> g(pools_mutex_);
+    return config_;
+}
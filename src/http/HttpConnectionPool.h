@@ -0,0 +1,100 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __HttpConnectionPool_H__
+#define __HttpConnectionPool_H__
+
+#include "kmdefs.h"
+#include "kmapi.h"
+#include "EventLoopImpl.h"
+#include "TcpSocketImpl.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+KUMA_NS_BEGIN
+
+/* the idle HTTP/1.x client connections of one event loop, the connections to same
+ * origin are reused by the new requests to skip TCP and TLS handshakes.
+ * all the methods except the static ones must be called on the loop thread
+ */
+class HttpConnectionPool final
+{
+public:
+    using Ptr = std::shared_ptr<HttpConnectionPool>;
+    using TcpSocketPtr = std::unique_ptr<TcpSocket::Impl>;
+    using Config = HttpConnectionPoolConfig;
+    
+    HttpConnectionPool(const EventLoopPtr &loop);
+    ~HttpConnectionPool();
+    
+    /* return an idle connection to key that is still alive, or nullptr.
+     * the most recently used connection is returned first
+     */
+    TcpSocketPtr getConnection(const std::string &key);
+    /* keep the connection for reuse, it is closed when the limits are exceeded
+     */
+    void addConnection(const std::string &key, TcpSocketPtr tcp);
+    size_t getIdleCount() const { return idle_conns_.size(); }
+    
+public:
+    // the pool of loop, it is created on first use and removed when the loop exits
+    static Ptr getPool(const EventLoopPtr &loop, bool create);
+    static void setConfig(const Config &config);
+    static Config getConfig();
+    
+private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+    struct IdleConnection
+    {
+        std::string     key;
+        TcpSocketPtr    tcp;
+        TimePoint       idle_since;
+    };
+    using IdleConnectionList = std::list<IdleConnection>;
+    
+    bool isAlive(TcpSocket::Impl &tcp);
+    void onIdleReceive(TcpSocket::Impl *tcp);
+    void removeExpired(const Config &config, TimePoint now);
+    void scheduleTimer(const Config &config, TimePoint now);
+    void onTimer();
+    void onLoopActivity(kev::LoopActivity acti);
+    void cleanup();
+    
+private:
+    EventLoopWeakPtr            loop_;
+    EventLoopToken              loop_token_;
+    Timer::Impl                 timer_;
+    bool                        timer_scheduled_ = false;
+    // the most recently used connection is at front
+    IdleConnectionList          idle_conns_;
+    
+    static std::mutex           pools_mutex_;
+    static std::map<kev::EventLoop::Impl*, Ptr> pools_;
+    static Config               config_;
+};
+
+KUMA_NS_END
+
+#endif
@@ -0,0 +1,560 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "HttpDiskCache.h"
+#include "libkev/src/utils/kmtrace.h"
+
+#ifndef KUMA_OS_WIN
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <dirent.h>
+#endif
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+KUMA_NS_USING
+
+namespace {
+    const uint32_t kRecordMagic = 0x32434d4b; // "KMC2", the record with body checksum
+    const uint32_t kFlagRemoved = 1;
+    const size_t kNumSegments = 8;
+    const size_t kMinSegmentSize = 1024 * 1024;
+    const std::string kSegmentPrefix = "kmcache-";
+    const std::string kSegmentSuffix = ".seg";
+    
+    /* the layout of record is header, key, meta, padding, body, padding. the magic is
+     * written at last, so a record which is not completely written is ignored on load
+     */
+    struct RecordHeader
+    {
+        uint32_t magic;
+        uint32_t checksum; // of the other header fields, key and meta
+        uint32_t flags;
+        uint32_t key_len;
+        uint32_t meta_len;
+        uint32_t body_checksum;
+        uint64_t body_len;
+    };
+    
+    size_t align8(size_t n)
+    {
+        return (n + 7) & ~size_t(7);
+    }
+    
+    size_t bodyOffset(const RecordHeader &hdr)
+    {
+        return align8(sizeof(RecordHeader) + hdr.key_len + hdr.meta_len);
+    }
+    
+    size_t recordLength(const RecordHeader &hdr)
+    {
+        return align8(bodyOffset(hdr) + hdr.body_len);
+    }
+    
+    uint32_t fnv1a(const void *data, size_t len, uint32_t hash = 2166136261u)
+    {
+        auto *p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; ++i) {
+            hash = (hash ^ p[i]) * 16777619u;
+        }
+        return hash;
+    }
+    
+    uint32_t checksum(const RecordHeader &hdr, const char *key_meta)
+    {
+        auto *fields = reinterpret_cast<const char*>(&hdr) + offsetof(RecordHeader, flags);
+        auto hash = fnv1a(fields, sizeof(RecordHeader) - offsetof(RecordHeader, flags));
+        return fnv1a(key_meta, hdr.key_len + hdr.meta_len, hash);
+    }
+    
+    template<typename T>
+    void putValue(std::string &buf, T v)
+    {
+        buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+    
+    void putString(std::string &buf, const std::string &str)
+    {
+        putValue(buf, static_cast<uint32_t>(str.size()));
+        buf.append(str);
+    }
+    
+    void putHeaders(std::string &buf, const HeaderVector &headers)
+    {
+        putValue(buf, static_cast<uint32_t>(headers.size()));
+        for (auto &kv : headers) {
+            putString(buf, kv.first);
+            putString(buf, kv.second);
+        }
+    }
+    
+    class MetaReader
+    {
+    public:
+        MetaReader(const char *data, size_t len) : ptr_(data), end_(data + len) {}
+        
+        template<typename T>
+        bool getValue(T &v)
+        {
+            if (static_cast<size_t>(end_ - ptr_) < sizeof(v)) {
+                return false;
+            }
+            memcpy(&v, ptr_, sizeof(v));
+            ptr_ += sizeof(v);
+            return true;
+        }
+        
+        bool getString(std::string &str)
+        {
+            uint32_t len = 0;
+            if (!getValue(len) || static_cast<size_t>(end_ - ptr_) < len) {
+                return false;
+            }
+            str.assign(ptr_, len);
+            ptr_ += len;
+            return true;
+        }
+        
+        bool getHeaders(HeaderVector &headers)
+        {
+            uint32_t count = 0;
+            if (!getValue(count)) {
+                return false;
+            }
+            headers.clear();
+            for (uint32_t i = 0; i < count; ++i) {
+                std::string name, value;
+                if (!getString(name) || !getString(value)) {
+                    return false;
+                }
+                headers.emplace_back(std::move(name), std::move(value));
+            }
+            return true;
+        }
+        
+    private:
+        const char* ptr_;
+        const char* end_;
+    };
+    
+    std::string encodeMeta(const HttpDiskCache::Record &record)
+    {
+        std::string meta;
+        putValue(meta, static_cast<int32_t>(record.status_code));
+        putValue(meta, static_cast<int32_t>(record.max_age));
+        putValue(meta, static_cast<int32_t>(record.age));
+        putValue(meta, record.write_time);
+        putHeaders(meta, record.headers);
+        putHeaders(meta, record.vary);
+        return meta;
+    }
+    
+    bool decodeMeta(const char *data, size_t len, HttpDiskCache::Record &record)
+    {
+        MetaReader reader(data, len);
+        int32_t status_code = 0, max_age = 0, age = 0;
+        if (!reader.getValue(status_code) || !reader.getValue(max_age) ||
+            !reader.getValue(age) || !reader.getValue(record.write_time) ||
+            !reader.getHeaders(record.headers) || !reader.getHeaders(record.vary)) {
+            return false;
+        }
+        record.status_code = status_code;
+        record.max_age = max_age;
+        record.age = age;
+        return true;
+    }
+}
+
+struct HttpDiskCache::Segment
+{
+    uint32_t    id = 0;
+    std::string path;
+    char*       data = nullptr;
+    size_t      size = 0;
+    size_t      write_offset = 0;
+    // the segment is dropped, the mapping is kept until its bodies are released
+    bool        dropped = false;
+    
+    ~Segment()
+    {
+#ifndef KUMA_OS_WIN
+        if (data) {
+            munmap(data, size);
+        }
+#endif
+    }
+};
+
+HttpDiskCache::~HttpDiskCache()
+{
+    close();
+}
+
+KMError HttpDiskCache::open(const std::string &dir, size_t capacity)
+{
+    close();
+#ifdef KUMA_OS_WIN
+    KM_WARNTRACE("HttpDiskCache::open, not supported");
+    return KMError::NOT_SUPPORTED;
+#else
+    if (dir.empty() || capacity == 0) {
+        return KMError::INVALID_PARAM;
+    }
+    if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        KM_ERRTRACE("HttpDiskCache::open, failed to create dir " << dir << ", err=" << errno);
+        return KMError::FAILED;
+    }
+    auto *d = opendir(dir.c_str());
+    if (!d) {
+        KM_ERRTRACE("HttpDiskCache::open, failed to open dir " << dir << ", err=" << errno);
+        return KMError::FAILED;
+    }
+    std::vector<uint32_t> ids;
+    while (auto *ent = readdir(d)) {
+        std::string name = ent->d_name;
+        if (name.size() > kSegmentPrefix.size() + kSegmentSuffix.size() &&
+            name.compare(0, kSegmentPrefix.size(), kSegmentPrefix) == 0 &&
+            name.compare(name.size() - kSegmentSuffix.size(), kSegmentSuffix.size(), kSegmentSuffix) == 0) {
+            ids.push_back(static_cast<uint32_t>(strtoul(name.c_str() + kSegmentPrefix.size(), nullptr, 10)));
+        }
+    }
+    closedir(d);
+    std::sort(ids.begin(), ids.end());
+    
+    std::lock_guard<std::mutex> g(mutex_);
+    dir_ = dir;
+    capacity_ = capacity;
+    segment_size_ = std::max(capacity / kNumSegments, kMinSegmentSize);
+    size_t total_size = 0;
+    for (auto id : ids) {
+        auto seg = openSegment(id);
+        if (seg) {
+            loadSegment(seg);
+            segments_.push_back(seg);
+            total_size += seg->size;
+        }
+        next_segment_id_ = id + 1;
+    }
+    while (total_size > capacity_ && !segments_.empty()) {
+        total_size -= segments_.front()->size;
+        dropSegment();
+    }
+    KM_INFOTRACE("HttpDiskCache::open, dir=" << dir << ", segments=" << segments_.size()
+                 << ", records=" << index_.size() << ", bytes=" << bytes_);
+    return KMError::NOERR;
+#endif
+}
+
+void HttpDiskCache::close()
+{
+    std::lock_guard<std::mutex> g(mutex_);
+    index_.clear();
+    segments_.clear();
+    bytes_ = 0;
+    dir_.clear();
+}
+
+std::string HttpDiskCache::getSegmentPath(uint32_t id) const
+{
+    return dir_ + "/" + kSegmentPrefix + std::to_string(id) + kSegmentSuffix;
+}
+
+HttpDiskCache::SegmentPtr HttpDiskCache::createSegment(uint32_t id)
+{
+#ifdef KUMA_OS_WIN
+    return nullptr;
+#else
+    auto path = getSegmentPath(id);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        KM_ERRTRACE("HttpDiskCache::createSegment, failed to create " << path << ", err=" << errno);
+        return nullptr;
+    }
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(segment_size_)) == 0) {
+        data = mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        KM_ERRTRACE("HttpDiskCache::createSegment, failed to map " << path << ", err=" << errno);
+        ::unlink(path.c_str());
+        return nullptr;
+    }
+    auto seg = std::make_shared<Segment>();
+    seg->id = id;
+    seg->path = std::move(path);
+    seg->data = static_cast<char*>(data);
+    seg->size = segment_size_;
+    return seg;
+#endif
+}
+
+HttpDiskCache::SegmentPtr HttpDiskCache::openSegment(uint32_t id)
+{
+#ifdef KUMA_OS_WIN
+    return nullptr;
+#else
+    auto path = getSegmentPath(id);
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(RecordHeader))) {
+        data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        KM_WARNTRACE("HttpDiskCache::openSegment, invalid segment " << path);
+        ::unlink(path.c_str());
+        return nullptr;
+    }
+    auto seg = std::make_shared<Segment>();
+    seg->id = id;
+    seg->path = std::move(path);
+    seg->data = static_cast<char*>(data);
+    seg->size = static_cast<size_t>(st.st_size);
+    return seg;
+#endif
+}
+
+void HttpDiskCache::loadSegment(const SegmentPtr &seg)
+{
+    size_t offset = 0;
+    while (offset + sizeof(RecordHeader) <= seg->size) {
+        RecordHeader hdr;
+        memcpy(&hdr, seg->data + offset, sizeof(hdr));
+        if (hdr.magic != kRecordMagic) {
+            break;
+        }
+        auto length = recordLength(hdr);
+        if (hdr.body_len > seg->size || length > seg->size - offset) {
+            break;
+        }
+        auto *key_meta = seg->data + offset + sizeof(hdr);
+        // the body is not hashed here, it is verified on first read
+        if (checksum(hdr, key_meta) != hdr.checksum) {
+            KM_WARNTRACE("HttpDiskCache::loadSegment, bad record, path=" << seg->path << ", offset=" << offset);
+            break;
+        }
+        std::string key(key_meta, hdr.key_len);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            bytes_ -= it->second.length;
+            index_.erase(it);
+        }
+        if (!(hdr.flags & kFlagRemoved)) {
+            bytes_ += length;
+            index_.emplace(std::move(key), Location{seg, offset, length});
+        }
+        offset += length;
+    }
+    seg->write_offset = offset;
+}
+
+HttpDiskCache::SegmentPtr HttpDiskCache::reserve(size_t length, size_t &offset)
+{
+    if (dir_.empty() || length > segment_size_) {
+        return nullptr;
+    }
+    auto seg = segments_.empty() ? nullptr : segments_.back();
+    if (!seg || seg->write_offset + length > seg->size) {
+        size_t total_size = segment_size_;
+        for (auto &s : segments_) {
+            total_size += s->size;
+        }
+        while (total_size > capacity_ && !segments_.empty()) {
+            total_size -= segments_.front()->size;
+            dropSegment();
+        }
+        seg = createSegment(next_segment_id_++);
+        if (!seg) {
+            return nullptr;
+        }
+        segments_.push_back(seg);
+    }
+    offset = seg->write_offset;
+    seg->write_offset += length;
+    return seg;
+}
+
+void HttpDiskCache::dropSegment()
+{
+    auto seg = std::move(segments_.front());
+    segments_.pop_front();
+    seg->dropped = true;
+    for (auto it = index_.begin(); it != index_.end(); ) {
+        if (it->second.segment == seg) {
+            bytes_ -= it->second.length;
+            it = index_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#ifndef KUMA_OS_WIN
+    ::unlink(seg->path.c_str());
+#endif
+    KM_INFOTRACE("HttpDiskCache::dropSegment, path=" << seg->path);
+}
+
+bool HttpDiskCache::append(const std::string &key, const std::string &meta, const KMBuffer *body, uint32_t flags)
+{
+    RecordHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.flags = flags;
+    hdr.key_len = static_cast<uint32_t>(key.size());
+    hdr.meta_len = static_cast<uint32_t>(meta.size());
+    hdr.body_len = body ? body->chainLength() : 0;
+    auto length = recordLength(hdr);
+    
+    size_t offset = 0;
+    SegmentPtr seg;
+    {
+        std::lock_guard<std::mutex> g(mutex_);
+        seg = reserve(length, offset);
+    }
+    if (!seg) {
+        return false;
+    }
+    // the data is copied without lock, the space is reserved for this record
+    auto *ptr = seg->data + offset;
+    memcpy(ptr + sizeof(hdr), key.data(), key.size());
+    memcpy(ptr + sizeof(hdr) + key.size(), meta.data(), meta.size());
+    if (body) {
+        body->readChained(ptr + bodyOffset(hdr), hdr.body_len);
+    }
+    hdr.body_checksum = fnv1a(ptr + bodyOffset(hdr), hdr.body_len);
+    hdr.checksum = checksum(hdr, ptr + sizeof(hdr));
+    memcpy(ptr + sizeof(hdr.magic), reinterpret_cast<char*>(&hdr) + sizeof(hdr.magic), sizeof(hdr) - sizeof(hdr.magic));
+    // the record must be visible before the magic which publishes it
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(ptr, &kRecordMagic, sizeof(kRecordMagic));
+    
+    std::lock_guard<std::mutex> g(mutex_);
+    if (seg->dropped) {
+        return false;
+    }
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        bytes_ -= it->second.length;
+        index_.erase(it);
+    }
+    if (!(flags & kFlagRemoved)) {
+        bytes_ += length;
+        index_.emplace(key, Location{seg, offset, length, true});
+    }
+    return true;
+}
+
+bool HttpDiskCache::write(const std::string &key, Record &record)
+{
+    if (!append(key, encodeMeta(record), &record.body, 0)) {
+        return false;
+    }
+    Record mapped;
+    if (!read(key, mapped)) {
+        return false;
+    }
+    record.body = std::move(mapped.body);
+    return true;
+}
+
+bool HttpDiskCache::read(const std::string &key, Record &record)
+{
+    Location loc;
+    {
+        std::lock_guard<std::mutex> g(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return false;
+        }
+        loc = it->second;
+    }
+    auto *ptr = loc.segment->data + loc.offset;
+    RecordHeader hdr;
+    memcpy(&hdr, ptr, sizeof(hdr));
+    if (!loc.verified) {
+        auto ok = fnv1a(ptr + bodyOffset(hdr), hdr.body_len) == hdr.body_checksum;
+        bool dropped = false;
+        {
+            std::lock_guard<std::mutex> g(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end() && it->second.segment == loc.segment && it->second.offset == loc.offset) {
+                if (ok) {
+                    it->second.verified = true;
+                } else {
+                    bytes_ -= it->second.length;
+                    index_.erase(it);
+                    dropped = true;
+                }
+            }
+        }
+        if (!ok) {
+            KM_WARNTRACE("HttpDiskCache::read, bad body, path=" << loc.segment->path << ", offset=" << loc.offset);
+            if (dropped) {
+                // so it is not loaded again on next open
+                append(key, "", nullptr, kFlagRemoved);
+            }
+            return false;
+        }
+    }
+    if (!decodeMeta(ptr + sizeof(hdr) + hdr.key_len, hdr.meta_len, record)) {
+        return false;
+    }
+    // the body refers to the mapping, which is kept until the body is released
+    auto seg = loc.segment;
+    KMBuffer body(ptr + bodyOffset(hdr), hdr.body_len, hdr.body_len, 0, [seg] (void*, size_t) {});
+    record.body = std::move(body);
+    return true;
+}
+
+void HttpDiskCache::remove(const std::string &key)
+{
+    if (contains(key)) {
+        append(key, "", nullptr, kFlagRemoved);
+    }
+}
+
+bool HttpDiskCache::contains(const std::string &key) const
+{
+    std::lock_guard<std::mutex> g(mutex_);
+    return index_.find(key) != index_.end();
+}
+
+size_t HttpDiskCache::getMaxRecordSize() const
+{
+    std::lock_guard<std::mutex> g(mutex_);
+    return segment_size_;
+}
+
+size_t HttpDiskCache::getBytes() const
+{
+    std::lock_guard<std::mutex> g(mutex_);
+    return bytes_;
+}
@@ -0,0 +1,116 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __HttpDiskCache_H__
+#define __HttpDiskCache_H__
+
+#include "kmdefs.h"
+#include "httpdefs.h"
+#include "kmbuffer.h"
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+KUMA_NS_BEGIN
+
+/* the disk tier of HttpCache. the responses are appended to segment files which are
+ * memory-mapped, the body read from disk tier refers to the mapping without copying.
+ * when the total size exceeds the capacity, the oldest segment is dropped. the index
+ * is rebuilt by scanning the record headers, keys and metas when it is opened, the body
+ * of a loaded record is verified on its first read
+ */
+class HttpDiskCache
+{
+public:
+    struct Record
+    {
+        int status_code = 0;
+        HeaderVector headers;
+        // the request headers selected by Vary
+        HeaderVector vary;
+        int max_age = 0;
+        // the Age of the response when it is written
+        int age = 0;
+        // seconds since epoch when it is written
+        int64_t write_time = 0;
+        KMBuffer body;
+    };
+    
+    HttpDiskCache() = default;
+    HttpDiskCache(const HttpDiskCache &) = delete;
+    HttpDiskCache& operator=(const HttpDiskCache &) = delete;
+    ~HttpDiskCache();
+    
+    KMError open(const std::string &dir, size_t capacity);
+    void close();
+    
+    /* write the record and replace its body with the mapped one. the body is copied and
+     * hashed in the calling thread
+     */
+    bool write(const std::string &key, Record &record);
+    /* the record with a corrupted body is removed and false is returned */
+    bool read(const std::string &key, Record &record);
+    /* remove the record of key, it will not be loaded on next open */
+    void remove(const std::string &key);
+    bool contains(const std::string &key) const;
+    
+    size_t getBytes() const;
+    /* the max length of a record, the body is a little less than it */
+    size_t getMaxRecordSize() const;
+    
+private:
+    struct Segment;
+    using SegmentPtr = std::shared_ptr<Segment>;
+    struct Location
+    {
+        SegmentPtr  segment;
+        size_t      offset = 0;
+        size_t      length = 0;
+        // the body checksum is checked, the records written by this process are trusted
+        bool        verified = false;
+    };
+    
+    SegmentPtr createSegment(uint32_t id);
+    SegmentPtr openSegment(uint32_t id);
+    void loadSegment(const SegmentPtr &seg);
+    /* reserve length bytes in current segment, the oldest segments are dropped if needed */
+    SegmentPtr reserve(size_t length, size_t &offset);
+    void dropSegment();
+    bool append(const std::string &key, const std::string &meta, const KMBuffer *body, uint32_t flags);
+    std::string getSegmentPath(uint32_t id) const;
+    
+private:
+    mutable std::mutex mutex_;
+    std::string dir_;
+    size_t capacity_ = 0;
+    size_t segment_size_ = 0;
+    uint32_t next_segment_id_ = 0;
+    std::deque<SegmentPtr> segments_;
+    std::unordered_map<std::string, Location> index_;
+    size_t bytes_ = 0;
+};
+
+KUMA_NS_END
+
+#endif
@@ -24,9 +24,48 @@
 
 #include <sstream>
 #include <algorithm>
+#include <limits>
+#include <stdio.h>
 
 using namespace kuma;
 
+namespace {
+
+bool isEqualN(const char *a, const char *b, size_t n)
+{
+#ifdef KUMA_OS_WIN
+    return _strnicmp(a, b, n) == 0;
+#else
+    return strncasecmp(a, b, n) == 0;
+#endif
+}
+
+// the headers are searched linearly below this count
+const size_t kMinIndexedHeaders = 8;
+const uint32_t kInvalidIndex = ~0u;
+
+// Content-Length must be digits only, the value that overflows size_t is rejected
+bool parseContentLength(const char *value, size_t value_len, size_t &length)
+{
+    if (value_len == 0) {
+        return false;
+    }
+    size_t v = 0;
+    for (size_t i = 0; i < value_len; ++i) {
+        if (value[i] < '0' || value[i] > '9') {
+            return false;
+        }
+        size_t d = value[i] - '0';
+        if (v > (std::numeric_limits<size_t>::max() - d) / 10) {
+            return false;
+        }
+        v = v * 10 + d;
+    }
+    length = v;
+    return true;
+}
+
+} // namespace
 
 HttpHeader::HttpHeader(bool is_outgoing, bool is_http2)
 : is_outgoing_(is_outgoing), is_http2_(is_http2)
@@ -39,10 +78,17 @@ KMError HttpHeader::addHeader(std::string name, std::string value)
     if(name.empty()) {
         return KMError::INVALID_PARAM;
     }
+    // keep the order of headers
+    materializeHeaders();
+    header_index_.clear();
     
     if (kev::is_equal(name, strContentLength)) {
+        size_t content_length = 0;
+        if (!parseContentLength(value.c_str(), value.size(), content_length)) {
+            return KMError::INVALID_PARAM;
+        }
         has_content_length_ = true;
-        content_length_ = std::stol(value);
+        content_length_ = content_length;
         if (is_outgoing_ && is_chunked_) {
             return KMError::NOERR;
         }
@@ -75,8 +121,152 @@ KMError HttpHeader::addHeader(std::string name, uint32_t value)
     return addHeader(std::move(name), std::to_string(value));
 }
 
+KMError HttpHeader::addHeaderRef(const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    if (name_len == 0) {
+        return KMError::INVALID_PARAM;
+    }
+    if (is_outgoing_ || is_http2_ || !header_vec_.empty()) {
+        return addHeader(std::string(name, name_len), std::string(value, value_len));
+    }
+    
+    if (name_len == strContentLength.size() &&
+        isEqualN(name, strContentLength.c_str(), name_len)) {
+        size_t content_length = 0;
+        if (!parseContentLength(value, value_len, content_length)) {
+            return KMError::INVALID_PARAM;
+        }
+        has_content_length_ = true;
+        content_length_ = content_length;
+    } else if (name_len == strTransferEncoding.size() &&
+               isEqualN(name, strTransferEncoding.c_str(), name_len)) {
+        is_chunked_ = true;
+    }
+    
+    HeaderRef ref;
+    ref.name_offset = static_cast<uint32_t>(header_block_.size());
+    ref.name_length = static_cast<uint32_t>(name_len);
+    header_block_.append(name, name_len);
+    ref.value_offset = static_cast<uint32_t>(header_block_.size());
+    ref.value_length = static_cast<uint32_t>(value_len);
+    header_block_.append(value, value_len);
+    // the value strings of previous message are reused
+    auto idx = header_refs_.size();
+    if (idx < ref_values_.size()) {
+        ref_values_[idx].clear();
+    } else {
+        ref_values_.emplace_back();
+    }
+    header_refs_.push_back(ref);
+    header_index_.clear();
+    
+    return KMError::NOERR;
+}
+
+size_t HttpHeader::headerCount() const
+{
+    // header_vec_ is empty if there are header refs
+    return !header_refs_.empty() ? header_refs_.size() : header_vec_.size();
+}
+
+bool HttpHeader::isHeaderName(size_t idx, const std::string &name) const
+{
+    if (!header_refs_.empty()) {
+        auto const &ref = header_refs_[idx];
+        return ref.name_length == name.size() &&
+            isEqualN(header_block_.c_str() + ref.name_offset, name.c_str(), name.size());
+    }
+    auto const &str = header_vec_[idx].first;
+    return str.size() == name.size() && isEqualN(str.c_str(), name.c_str(), name.size());
+}
+
+void HttpHeader::buildHeaderIndex() const
+{
+    auto count = headerCount();
+    size_t capacity = 16;
+    while (capacity < count * 2) {
+        capacity <<= 1;
+    }
+    auto mask = capacity - 1;
+    header_index_.assign(capacity, IndexEntry{ 0, kInvalidIndex });
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t hash = 0;
+        if (!header_refs_.empty()) {
+            auto const &ref = header_refs_[i];
+            hash = hashHeaderName(header_block_.c_str() + ref.name_offset, ref.name_length);
+        } else {
+            auto const &str = header_vec_[i].first;
+            hash = hashHeaderName(str.c_str(), str.size());
+        }
+        // linear probing, the first header of the same name stays ahead in the probe sequence
+        auto slot = hash & mask;
+        while (header_index_[slot].index != kInvalidIndex) {
+            slot = (slot + 1) & mask;
+        }
+        header_index_[slot] = IndexEntry{ hash, static_cast<uint32_t>(i) };
+    }
+}
+
+int HttpHeader::findHeader(const std::string &name, uint32_t hash) const
+{
+    auto count = headerCount();
+    if (count < kMinIndexedHeaders) {
+        for (size_t i = 0; i < count; ++i) {
+            if (isHeaderName(i, name)) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+    if (header_index_.empty()) {
+        buildHeaderIndex();
+    }
+    auto mask = header_index_.size() - 1;
+    auto slot = hash & mask;
+    while (header_index_[slot].index != kInvalidIndex) {
+        auto const &entry = header_index_[slot];
+        if (entry.hash == hash && isHeaderName(entry.index, name)) {
+            return static_cast<int>(entry.index);
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+const std::string& HttpHeader::getHeaderValue(int idx) const
+{
+    if (idx < 0) {
+        return EmptyString;
+    }
+    if (!header_refs_.empty()) {
+        auto const &ref = header_refs_[idx];
+        auto &value = ref_values_[idx];
+        if (value.empty() && ref.value_length > 0) {
+            value.assign(header_block_, ref.value_offset, ref.value_length);
+        }
+        return value;
+    }
+    return header_vec_[idx].second;
+}
+
+void HttpHeader::materializeHeaders() const
+{
+    if (header_refs_.empty()) {
+        return;
+    }
+    header_vec_.reserve(header_vec_.size() + header_refs_.size());
+    for (auto const &ref : header_refs_) {
+        header_vec_.emplace_back(header_block_.substr(ref.name_offset, ref.name_length),
+                                 header_block_.substr(ref.value_offset, ref.value_length));
+    }
+    // ref_values_ is kept until reset, its strings may be referenced by the caller
+    header_refs_.clear();
+}
+
 bool HttpHeader::removeHeader(const std::string &name)
 {
+    materializeHeaders();
+    header_index_.clear();
     bool removed = false;
     auto it = header_vec_.begin();
     while (it != header_vec_.end()) {
@@ -93,6 +283,8 @@ bool HttpHeader::removeHeader(const std::string &name)
 
 bool HttpHeader::removeHeaderValue(const std::string &name, const std::string &value)
 {
+    materializeHeaders();
+    header_index_.clear();
     bool removed = false;
     auto it = header_vec_.begin();
     while (it != header_vec_.end()) {
@@ -116,27 +308,27 @@ bool HttpHeader::removeHeaderValue(const std::string &name, const std::string &v
 
 bool HttpHeader::hasHeader(const std::string &name) const
 {
-    for (auto const &kv : header_vec_) {
-        if (kev::is_equal(kv.first, name)) {
-            return true;
-        }
-    }
-    return false;
+    return findHeader(name, hashHeaderName(name.c_str(), name.size())) >= 0;
+}
+
+bool HttpHeader::hasHeader(const HeaderKey &key) const
+{
+    return findHeader(key.name(), key.hash()) >= 0;
 }
 
 const std::string& HttpHeader::getHeader(const std::string &name) const
 {
-    for (auto const &kv : header_vec_) {
-        if (kev::is_equal(kv.first, name)) {
-            return kv.second;
-        }
-    }
-    return EmptyString;
+    return getHeaderValue(findHeader(name, hashHeaderName(name.c_str(), name.size())));
+}
+
+const std::string& HttpHeader::getHeader(const HeaderKey &key) const
+{
+    return getHeaderValue(findHeader(key.name(), key.hash()));
 }
 
 bool HttpHeader::isUpgradeHeader() const
 {
-    return hasHeader(strUpgrade) && kev::contains_token(getHeader("Connection"), strUpgrade, ',');
+    return hasHeader(keyUpgrade) && kev::contains_token(getHeader(keyConnection), strUpgrade, ',');
 }
 
 void HttpHeader::processHeader()
@@ -163,29 +355,55 @@ void HttpHeader::processHeader(int status_code, const std::string &req_method)
 
 std::string HttpHeader::buildHeader(const std::string &method, const std::string &url, const std::string &ver)
 {
-    processHeader();
-    std::string req = method + " " + url + " " + (!ver.empty()?ver:VersionHTTP1_1);
-    req += "\r\n";
-    for (auto &kv : header_vec_) {
-        req += kv.first + ": " + kv.second + "\r\n";
-    }
-    req += "\r\n";
+    std::string req;
+    buildHeader(method, url, ver, req);
     return req;
 }
 
 std::string HttpHeader::buildHeader(int status_code, const std::string &desc, const std::string &ver, const std::string &req_method)
+{
+    std::string rsp;
+    buildHeader(status_code, desc, ver, req_method, rsp);
+    return rsp;
+}
+
+void HttpHeader::buildHeader(const std::string &method, const std::string &url, const std::string &ver, std::string &buf)
+{
+    processHeader();
+    buf.assign(method);
+    buf += ' ';
+    buf += url;
+    buf += ' ';
+    buf += !ver.empty()?ver:VersionHTTP1_1;
+    buf += "\r\n";
+    appendHeaders(buf);
+}
+
+void HttpHeader::buildHeader(int status_code, const std::string &desc, const std::string &ver, const std::string &req_method, std::string &buf)
 {
     processHeader(status_code, req_method);
-    std::string rsp = (!ver.empty()?ver:VersionHTTP1_1) + " " + std::to_string(status_code);
+    char status[16];
+    auto status_len = snprintf(status, sizeof(status), " %d", status_code);
+    buf.assign(!ver.empty()?ver:VersionHTTP1_1);
+    buf.append(status, status_len);
     if (!desc.empty()) {
-        rsp += " " + desc;
+        buf += ' ';
+        buf += desc;
     }
-    rsp += "\r\n";
+    buf += "\r\n";
+    appendHeaders(buf);
+}
+
+void HttpHeader::appendHeaders(std::string &buf) const
+{
+    materializeHeaders();
     for (auto &kv : header_vec_) {
-        rsp += kv.first + ": " + kv.second + "\r\n";
+        buf += kv.first;
+        buf += ": ";
+        buf += kv.second;
+        buf += "\r\n";
     }
-    rsp += "\r\n";
-    return rsp;
+    buf += "\r\n";
 }
 
 void HttpHeader::reset()
@@ -195,6 +413,11 @@ void HttpHeader::reset()
     is_chunked_ = false;
     has_body_ = false;
     header_vec_.clear();
+    // keep the capacity for next message
+    header_block_.clear();
+    header_refs_.clear();
+    // ref_values_ is reused by next message, see addHeaderRef
+    header_index_.clear();
 }
 
 void HttpHeader::setHeaders(const HeaderVector &headers)
@@ -217,6 +440,10 @@ HttpHeader& HttpHeader::operator= (const HttpHeader &other)
         content_length_ = other.content_length_;
         has_body_ = other.has_body_;
         header_vec_ = other.header_vec_;
+        header_block_ = other.header_block_;
+        header_refs_ = other.header_refs_;
+        ref_values_ = other.ref_values_;
+        header_index_.clear();
     }
     
     return *this;
@@ -230,6 +457,10 @@ HttpHeader& HttpHeader::operator= (HttpHeader &&other)
         content_length_ = other.content_length_;
         has_body_ = other.has_body_;
         header_vec_ = std::move(other.header_vec_);
+        header_block_ = std::move(other.header_block_);
+        header_refs_ = std::move(other.header_refs_);
+        ref_values_ = std::move(other.ref_values_);
+        header_index_.clear();
     }
     
     return *this;
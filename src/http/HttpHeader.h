@@ -26,6 +26,8 @@
 #include "kmapi.h"
 #include "httpdefs.h"
 
+#include <deque>
+
 KUMA_NS_BEGIN
 
 class HttpHeader
@@ -35,21 +37,43 @@ public:
     virtual ~HttpHeader() {}
     virtual KMError addHeader(std::string name, std::string value);
     virtual KMError addHeader(std::string name, uint32_t value);
+    /* add incoming header without creating strings, name and value are copied into
+     * the header block and the strings are created on demand. they must be trimmed
+     */
+    KMError addHeaderRef(const char *name, size_t name_len, const char *value, size_t value_len);
     virtual bool removeHeader(const std::string &name);
     virtual bool removeHeaderValue(const std::string &name, const std::string &value);
     bool hasHeader(const std::string &name) const;
+    bool hasHeader(const HeaderKey &key) const;
     const std::string& getHeader(const std::string &name) const;
+    const std::string& getHeader(const HeaderKey &key) const;
     std::string buildHeader(const std::string &method, const std::string &url, const std::string &ver);
     std::string buildHeader(int status_code, const std::string &desc, const std::string &ver, const std::string &req_method);
+    /* build into buf, its capacity is reused when buf is kept by caller */
+    void buildHeader(const std::string &method, const std::string &url, const std::string &ver, std::string &buf);
+    void buildHeader(int status_code, const std::string &desc, const std::string &ver, const std::string &req_method, std::string &buf);
     bool hasBody() const { return has_body_; }
     bool hasContentLength() const { return has_content_length_; }
     bool isChunked() const { return is_chunked_; }
     size_t getContentLength() const { return content_length_; }
+    /* the Content-Length header is serialized by others, e.g. HttpHeaderTemplate
+     */
+    void setContentLength(size_t length)
+    {
+        has_content_length_ = true;
+        content_length_ = length;
+        is_chunked_ = false;
+    }
     virtual void reset();
     void setHeaders(const HeaderVector &headers);
     void setHeaders(HeaderVector &&headers);
-    HeaderVector& getHeaders() { return header_vec_; }
-    const HeaderVector& getHeaders() const { return header_vec_; }
+    HeaderVector& getHeaders()
+    {
+        materializeHeaders();
+        header_index_.clear(); // the headers may be modified by caller
+        return header_vec_;
+    }
+    const HeaderVector& getHeaders() const { materializeHeaders(); return header_vec_; }
     
     bool isUpgradeHeader() const;
     void processHeader();
@@ -58,6 +82,24 @@ public:
     HttpHeader& operator= (const HttpHeader &other);
     HttpHeader& operator= (HttpHeader &&other);
     
+protected:
+    // the range of header name and value in header_block_
+    struct HeaderRef
+    {
+        uint32_t    name_offset;
+        uint32_t    name_length;
+        uint32_t    value_offset;
+        uint32_t    value_length;
+    };
+    
+    int findHeader(const std::string &name, uint32_t hash) const;
+    size_t headerCount() const;
+    bool isHeaderName(size_t idx, const std::string &name) const;
+    void buildHeaderIndex() const;
+    void materializeHeaders() const;
+    const std::string& getHeaderValue(int idx) const;
+    void appendHeaders(std::string &buf) const;
+    
 protected:
     bool                    is_http2_ = false;
     bool                    is_outgoing_ = true;
@@ -65,7 +107,22 @@ protected:
     bool                    has_content_length_ = false;
     bool                    has_body_ = false;
     size_t                  content_length_ = 0;
-    HeaderVector            header_vec_;
+    // the headers added by addHeaderRef are moved to header_vec_ when getHeaders called
+    mutable HeaderVector    header_vec_;
+    
+    std::string             header_block_;
+    mutable std::vector<HeaderRef> header_refs_;
+    // the values returned by getHeader, deque keeps the references valid.
+    // the strings are kept on reset and reused by next message
+    mutable std::deque<std::string> ref_values_;
+    
+    struct IndexEntry
+    {
+        uint32_t    hash;
+        uint32_t    index;
+    };
+    // open addressing hash table of header names, built on first lookup
+    mutable std::vector<IndexEntry> header_index_;
 };
 
 KUMA_NS_END
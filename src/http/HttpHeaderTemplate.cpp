@@ -0,0 +1,81 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "HttpHeaderTemplate.h"
+#include "httputils.h"
+#include "libkev/src/utils/utils.h"
+
+using namespace kuma;
+
+HttpHeaderTemplate::Impl::Impl(int status_code, const std::string &desc, const std::string &ver)
+: status_code_(status_code)
+{
+    auto const &version = !ver.empty() ? ver : VersionHTTP1_1;
+    is_http1x_ = !kev::is_equal(version, VersionHTTP2_0);
+    // the responses without body must not have Content-Length, except 304 which
+    // may have the one of the selected representation
+    has_content_length_ = !((status_code >= 100 && status_code <= 199) ||
+                            status_code == 204 || status_code == 304);
+    prefix_ = version + " " + std::to_string(status_code);
+    if (!desc.empty()) {
+        prefix_ += " " + desc;
+    }
+    prefix_ += "\r\n";
+}
+
+KMError HttpHeaderTemplate::Impl::addHeader(const std::string &name, const std::string &value)
+{
+    if (name.empty()) {
+        return KMError::INVALID_PARAM;
+    }
+    if (kev::is_equal(name, strContentLength) || kev::is_equal(name, strTransferEncoding) ||
+        kev::is_equal(name, "Date")) {
+        // filled when the response is sent
+        return KMError::INVALID_PARAM;
+    }
+    if (kev::is_equal(name, strConnection)) {
+        connection_ = value;
+    }
+    prefix_ += name + ": " + value + "\r\n";
+    return KMError::NOERR;
+}
+
+void HttpHeaderTemplate::Impl::buildHeader(std::string &buf, size_t content_length) const
+{
+    static const char kDateSlot[] = "Date: ";
+    static const char kContentLengthSlot[] = "\r\nContent-Length: ";
+    
+    buf.assign(prefix_);
+    buf.append(kDateSlot, sizeof(kDateSlot) - 1);
+    buf.append(getHttpDate(), kHttpDateLength);
+    if (has_content_length_) {
+        char digits[24];
+        auto *p = digits + sizeof(digits);
+        do {
+            *--p = static_cast<char>('0' + content_length % 10);
+            content_length /= 10;
+        } while (content_length > 0);
+        buf.append(kContentLengthSlot, sizeof(kContentLengthSlot) - 1);
+        buf.append(p, digits + sizeof(digits) - p);
+    }
+    buf.append("\r\n\r\n", 4);
+}
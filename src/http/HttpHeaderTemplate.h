@@ -0,0 +1,62 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef __HttpHeaderTemplate_H__
+#define __HttpHeaderTemplate_H__
+
+#include "kmdefs.h"
+#include "kmapi.h"
+#include "httpdefs.h"
+
+#include <string>
+
+KUMA_NS_BEGIN
+
+class HttpHeaderTemplate::Impl
+{
+public:
+    Impl(int status_code, const std::string &desc, const std::string &ver);
+    
+    KMError addHeader(const std::string &name, const std::string &value);
+    int getStatusCode() const { return status_code_; }
+    bool isHttp1x() const { return is_http1x_; }
+    /* the value of Connection header, it decides if the connection is kept alive */
+    const std::string& getConnection() const { return connection_; }
+    
+    /* serialize the response header to buf, only Date and Content-Length are filled,
+     * and Content-Length is not for 1xx, 204 and 304.
+     * buf is reused by the caller so no memory is allocated in most cases
+     */
+    void buildHeader(std::string &buf, size_t content_length) const;
+    
+private:
+    int                 status_code_{ 200 };
+    bool                is_http1x_{ true };
+    bool                has_content_length_{ true };
+    std::string         connection_;
+    // status line and the fixed headers
+    std::string         prefix_;
+};
+
+KUMA_NS_END
+
+#endif
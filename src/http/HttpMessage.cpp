@@ -20,8 +20,7 @@
  */
 
 #include "HttpMessage.h"
-
-#include <sstream>
+#include "httputils.h"
 
 using namespace kuma;
 
@@ -89,14 +88,11 @@ int HttpMessage::sendChunk(const void* data, size_t len)
         }
         return ret;
     } else {
-        std::stringstream ss;
-        ss << std::hex << len;
-        std::string str;
-        ss >> str;
-        str += "\r\n";
+        char size_line[kMaxChunkSizeLineLength];
+        auto size_len = formatChunkSizeLine(len, size_line);
         iovec iovs[3];
-        iovs[0].iov_base = (char*)str.c_str();
-        iovs[0].iov_len = static_cast<decltype(iovs[0].iov_len)>(str.length());
+        iovs[0].iov_base = size_line;
+        iovs[0].iov_len = static_cast<decltype(iovs[0].iov_len)>(size_len);
         iovs[1].iov_base = (char*)data;
         iovs[1].iov_len = static_cast<decltype(iovs[1].iov_len)>(len);
         iovs[2].iov_base = (char*)"\r\n";
@@ -122,12 +118,9 @@ int HttpMessage::sendChunk(const KMBuffer &buf)
         }
         return ret;
     } else {
-        std::stringstream ss;
-        ss << std::hex << buf_len;
-        std::string str;
-        ss >> str;
-        str += "\r\n";
-        KMBuffer hdr(str.c_str(), str.size(), str.size());
+        char size_line[kMaxChunkSizeLineLength];
+        auto size_len = formatChunkSizeLine(buf_len, size_line);
+        KMBuffer hdr(size_line, size_len, size_len);
         
         // temporary link to hdr
         hdr.append(const_cast<KMBuffer*>(&buf));
@@ -0,0 +1,244 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "HttpParams.h"
+#include "httputils.h"
+
+#include <algorithm>
+
+using namespace kuma;
+
+KeyValueList::iterator HttpParams::lowerBound(const std::string &name)
+{
+    return std::lower_bound(params_.begin(), params_.end(), name,
+                            [] (const KeyValuePair &kv, const std::string &n) {
+        return CaseIgnoreLess()(kv.first, n);
+    });
+}
+
+KeyValueList::const_iterator HttpParams::lowerBound(const std::string &name) const
+{
+    return std::lower_bound(params_.begin(), params_.end(), name,
+                            [] (const KeyValuePair &kv, const std::string &n) {
+        return CaseIgnoreLess()(kv.first, n);
+    });
+}
+
+void HttpParams::add(std::string name, std::string value)
+{
+    if (name.empty()) {
+        return;
+    }
+    ensureSorted();
+    auto it = lowerBound(name);
+    if (it != params_.end() && !CaseIgnoreLess()(name, it->first)) {
+        it->second = std::move(value);
+    } else {
+        params_.emplace(it, std::move(name), std::move(value));
+    }
+}
+
+void HttpParams::append(std::string name, std::string value)
+{
+    if (name.empty()) {
+        return;
+    }
+    params_.emplace_back(std::move(name), std::move(value));
+    unsorted_ = true;
+}
+
+void HttpParams::ensureSorted() const
+{
+    if (!unsorted_) {
+        return;
+    }
+    unsorted_ = false;
+    std::stable_sort(params_.begin(), params_.end(), [] (const KeyValuePair &a, const KeyValuePair &b) {
+        return CaseIgnoreLess()(a.first, b.first);
+    });
+    // keep the last one of same names
+    auto out = params_.begin();
+    for (auto it = params_.begin(); it != params_.end(); ++it) {
+        auto next = it + 1;
+        if (next != params_.end() && !CaseIgnoreLess()(it->first, next->first)) {
+            continue;
+        }
+        if (out != it) {
+            *out = std::move(*it);
+        }
+        ++out;
+    }
+    params_.erase(out, params_.end());
+}
+
+const std::string& HttpParams::get(const std::string &name) const
+{
+    ensureSorted();
+    auto it = lowerBound(name);
+    if (it != params_.end() && !CaseIgnoreLess()(name, it->first)) {
+        return it->second;
+    }
+    return EmptyString;
+}
+
+void HttpParams::forEach(const EnumerateCallback &cb) const
+{
+    ensureSorted();
+    for (auto &kv : params_) {
+        if (!cb(kv.first, kv.second)) {
+            break;
+        }
+    }
+}
+
+void HttpParams::parseQuery(const std::string &query)
+{
+    std::string::size_type pos = 0;
+    while (true) {
+        auto pos1 = query.find('=', pos);
+        if(pos1 == std::string::npos){
+            break;
+        }
+        std::string name(query.begin()+pos, query.begin()+pos1);
+        pos = pos1 + 1;
+        pos1 = query.find('&', pos);
+        if(pos1 == std::string::npos){
+            add(std::move(name), std::string(query.begin()+pos, query.end()));
+            break;
+        }
+        add(std::move(name), std::string(query.begin()+pos, query.begin()+pos1));
+        pos = pos1 + 1;
+    }
+}
+
+KMError FormUrlEncodedParser::parse(const char *data, size_t len, HttpParams &params)
+{
+    bytes_ += len;
+    if (bytes_ > max_bytes_) {
+        return KMError::BUFFER_TOO_SMALL;
+    }
+    for (auto *p = data, *end = data + len; p < end; ++p) {
+        char c = *p;
+        if (pct_digits_ >= 0) {
+            auto v = hexDigitValue(c);
+            if (v < 0) {
+                // not a percent-encoded byte, keep it as is
+                if (flushPercent() != KMError::NOERR) {
+                    return KMError::BUFFER_TOO_SMALL;
+                }
+            } else if (pct_digits_ == 0) {
+                pct_value_ = v;
+                pct_first_ = c;
+                pct_digits_ = 1;
+                continue;
+            } else {
+                pct_digits_ = -1;
+                if (appendChar(static_cast<char>((pct_value_ << 4) | v)) != KMError::NOERR) {
+                    return KMError::BUFFER_TOO_SMALL;
+                }
+                continue;
+            }
+        }
+        KMError err = KMError::NOERR;
+        switch (c) {
+            case '&':
+                err = addField(params);
+                break;
+            case '=':
+                if (in_value_) {
+                    err = appendChar(c);
+                } else {
+                    in_value_ = true;
+                }
+                break;
+            case '+':
+                err = appendChar(' ');
+                break;
+            case '%':
+                pct_digits_ = 0;
+                pct_value_ = 0;
+                break;
+            default:
+                err = appendChar(c);
+                break;
+        }
+        if (err != KMError::NOERR) {
+            return err;
+        }
+    }
+    return KMError::NOERR;
+}
+
+KMError FormUrlEncodedParser::finish(HttpParams &params)
+{
+    if (pct_digits_ >= 0 && flushPercent() != KMError::NOERR) {
+        return KMError::BUFFER_TOO_SMALL;
+    }
+    return addField(params);
+}
+
+void FormUrlEncodedParser::reset()
+{
+    name_.clear();
+    value_.clear();
+    in_value_ = false;
+    pct_digits_ = -1;
+    pct_value_ = 0;
+    bytes_ = 0;
+    fields_ = 0;
+}
+
+KMError FormUrlEncodedParser::flushPercent()
+{
+    auto digits = pct_digits_;
+    pct_digits_ = -1;
+    auto err = appendChar('%');
+    if (err == KMError::NOERR && digits == 1) {
+        err = appendChar(pct_first_);
+    }
+    return err;
+}
+
+KMError FormUrlEncodedParser::appendChar(char c)
+{
+    auto &str = in_value_ ? value_ : name_;
+    if (str.size() >= kMaxFieldSize) {
+        return KMError::BUFFER_TOO_SMALL;
+    }
+    str.push_back(c);
+    return KMError::NOERR;
+}
+
+KMError FormUrlEncodedParser::addField(HttpParams &params)
+{
+    KMError err = KMError::NOERR;
+    if (!name_.empty()) {
+        if (++fields_ > max_fields_) {
+            err = KMError::BUFFER_TOO_SMALL;
+        } else {
+            params.append(std::move(name_), std::move(value_));
+        }
+    }
+    name_.clear();
+    value_.clear();
+    in_value_ = false;
+    return err;
+}
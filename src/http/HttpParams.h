@@ -0,0 +1,105 @@
+/* Copyright (c) 2014-2025, Fengping Bao <jamol@live.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __HttpParams_H__
+#define __HttpParams_H__
+
+#include "kmdefs.h"
+#include "httpdefs.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+KUMA_NS_BEGIN
+
+/* the parameters of query string or form body, kept in a vector sorted by
+ * case-insensitive name. the appended ones are sorted on next lookup
+ */
+class HttpParams
+{
+public:
+    using EnumerateCallback = std::function<bool(const std::string&, const std::string&)>;
+    
+    /* the value is replaced if name exists already */
+    void add(std::string name, std::string value);
+    /* add without lookup, the last value wins if name is appended more than once */
+    void append(std::string name, std::string value);
+    const std::string& get(const std::string &name) const;
+    void forEach(const EnumerateCallback &cb) const;
+    size_t size() const { ensureSorted(); return params_.size(); }
+    bool empty() const { return params_.empty(); }
+    void clear() { params_.clear(); unsorted_ = false; }
+    
+    /* split query "a=1&b=2", the query was decoded with the url already */
+    void parseQuery(const std::string &query);
+    
+private:
+    KeyValueList::iterator lowerBound(const std::string &name);
+    KeyValueList::const_iterator lowerBound(const std::string &name) const;
+    // sort once and remove the duplicate names
+    void ensureSorted() const;
+    
+private:
+    mutable KeyValueList params_;
+    mutable bool        unsorted_{ false };
+};
+
+/* incremental parser of application/x-www-form-urlencoded body, the data can be
+ * split anywhere, including inside of a percent-encoded byte
+ */
+class FormUrlEncodedParser
+{
+public:
+    /* parse returns error once the body exceeds max_bytes or max_fields */
+    FormUrlEncodedParser(size_t max_bytes, size_t max_fields)
+    : max_bytes_(max_bytes), max_fields_(max_fields) {}
+    
+    KMError parse(const char *data, size_t len, HttpParams &params);
+    /* end of body, the pending field is added */
+    KMError finish(HttpParams &params);
+    void reset();
+    
+private:
+    KMError appendChar(char c);
+    // the incomplete percent-encoded byte is kept literally
+    KMError flushPercent();
+    KMError addField(HttpParams &params);
+    
+private:
+    static const size_t kMaxFieldSize = 64 * 1024;
+    
+    size_t              max_bytes_;
+    size_t              max_fields_;
+    size_t              bytes_{ 0 };
+    size_t              fields_{ 0 };
+    std::string         name_;
+    std::string         value_;
+    bool                in_value_{ false };
+    // the count of hex digits received after '%'
+    int                 pct_digits_{ -1 };
+    int                 pct_value_{ 0 };
+    char                pct_first_{ 0 };
+};
+
+KUMA_NS_END
+
+#endif
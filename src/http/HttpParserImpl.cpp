@@ -23,8 +23,11 @@
 #include "libkev/src/utils/kmtrace.h"
 #include "libkev/src/utils/utils.h"
 #include "Uri.h"
+#include "httputils.h"
 
 #include <algorithm>
+#include <string.h>
+#include <stdint.h>
 
 using namespace kuma;
 
@@ -74,9 +77,22 @@ HttpParser::Impl& HttpParser::Impl::operator=(const Impl& other)
         url_ = other.url_;
         url_path_ = other.url_path_;
         url_query_ = other.url_query_;
-        param_map_ = other.param_map_;
+        params_ = other.params_;
+        params_parsed_ = other.params_parsed_;
+        if (other.form_parser_) {
+            form_parser_.reset(new FormUrlEncodedParser(*other.form_parser_));
+        } else {
+            form_parser_.reset();
+        }
         header_vec_ = other.header_vec_;
+        header_block_ = other.header_block_;
+        header_refs_ = other.header_refs_;
+        ref_values_ = other.ref_values_;
+        header_index_.clear();
         status_code_ = other.status_code_;
+        limits_ = other.limits_;
+        header_bytes_ = other.header_bytes_;
+        error_status_ = other.error_status_;
     }
     return *this;
 }
@@ -105,16 +121,26 @@ HttpParser::Impl& HttpParser::Impl::operator=(Impl&& other)
         url_.swap(other.url_);
         url_path_.swap(other.url_path_);
         url_query_.swap(other.url_query_);
-        param_map_.swap(other.param_map_);
+        std::swap(params_, other.params_);
+        params_parsed_ = other.params_parsed_;
+        form_parser_ = std::move(other.form_parser_);
         header_vec_.swap(other.header_vec_);
+        header_block_.swap(other.header_block_);
+        header_refs_.swap(other.header_refs_);
+        ref_values_.swap(other.ref_values_);
+        header_index_.clear();
+        other.header_index_.clear();
         status_code_ = other.status_code_;
+        limits_ = other.limits_;
+        header_bytes_ = other.header_bytes_;
+        error_status_ = other.error_status_;
     }
     return *this;
 }
 
 HttpParser::Impl::~Impl()
 {
-    param_map_.clear();
+    params_.clear();
     header_vec_.clear();
 }
 
@@ -132,14 +158,19 @@ void HttpParser::Impl::reset()
     chunk_bytes_read_ = 0;
     
     total_bytes_read_ = 0;
+    header_bytes_ = 0;
+    error_status_ = 0;
     str_buf_.clear();
     
     method_ = "";
     url_ = "";
     version_ = "";
     url_path_ = "";
+    url_query_ = "";
     
-    param_map_.clear();
+    params_.clear();
+    params_parsed_ = false;
+    form_parser_.reset();
 }
 
 bool HttpParser::Impl::complete() const
@@ -152,17 +183,25 @@ bool HttpParser::Impl::error() const
     return HTTP_READ_ERROR == read_state_;
 }
 
+int HttpParser::Impl::getErrorStatus() const
+{
+    if (!error()) {
+        return 0;
+    }
+    return error_status_ != 0 ? error_status_ : 400;
+}
+
 bool HttpParser::Impl::isUpgradeTo(const std::string& protocol) const
 {
-    if (!kev::is_equal(getHeaderValue("Upgrade"), protocol) ||
-        !kev::contains_token(getHeaderValue("Connection"), "Upgrade", ',')) {
+    if (!kev::is_equal(HttpHeader::getHeader(keyUpgrade), protocol) ||
+        !kev::contains_token(HttpHeader::getHeader(keyConnection), "Upgrade", ',')) {
         return false;
     }
     if (!isRequest() && 101 != getStatusCode()) {
         return false;
     }
     if (isRequest() && kev::is_equal(protocol, "h2c") &&
-        !kev::contains_token(getHeaderValue("Connection"), "HTTP2-Settings", ',')) {
+        !kev::contains_token(HttpHeader::getHeader(keyConnection), "HTTP2-Settings", ',')) {
         return false;
     }
     return true;
@@ -207,7 +246,12 @@ int HttpParser::Impl::parse(const KMBuffer &buf)
     for (auto it = buf.begin(); it != buf.end(); ++it) {
         if (it->length() > 0) {
             int bytes_parsed = 0;
+            cur_buf_ = &(*it);
             auto parse_state = parse(static_cast<char*>(it->readPtr()), it->length(), &bytes_parsed);
+            if(PARSE_STATE_DESTROYED == parse_state) {
+                return total_parsed + bytes_parsed;
+            }
+            cur_buf_ = nullptr;
             total_parsed += bytes_parsed;
             if(PARSE_STATE_CONTINUE != parse_state) {
                 if(PARSE_STATE_ERROR == parse_state && event_cb_) {
@@ -243,6 +287,15 @@ KMError HttpParser::Impl::saveData(const char* cur_pos, const char* end)
     return KMError::NOERR;
 }
 
+HttpParser::Impl::ParseState HttpParser::Impl::onParseError(int status)
+{
+    read_state_ = HTTP_READ_ERROR;
+    error_status_ = status;
+    // release the memory of the rejected message at once
+    std::string().swap(str_buf_);
+    return PARSE_STATE_ERROR;
+}
+
 HttpParser::Impl::ParseState HttpParser::Impl::parse(const char* data, size_t len, int *bytes_read)
 {
     if(HTTP_READ_DONE == read_state_ || HTTP_READ_ERROR == read_state_) {
@@ -270,6 +323,7 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseHttp(const char*& cur_pos, c
 {
     const char* line = nullptr;
     const char* line_end = nullptr;
+    const char* colon = nullptr;
     bool b_line = false;
     
     if(HTTP_READ_LINE == read_state_)
@@ -277,15 +331,23 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseHttp(const char*& cur_pos, c
         while ((b_line = getLine(cur_pos, end, line, line_end)) && line == line_end && str_buf_.empty())
             ;
         if(b_line && (line != line_end || !str_buf_.empty())) {
+            if(str_buf_.size() + (line_end - line) > limits_.max_start_line) {
+                KM_WARNTRACE("HttpParser::parseHttp, start line is too long");
+                return onParseError(400);
+            }
+            header_bytes_ = str_buf_.size() + (cur_pos - line);
             if(!parseStartLine(line, line_end)) {
-                read_state_ = HTTP_READ_ERROR;
-                return PARSE_STATE_ERROR;
+                return onParseError(400);
             }
             read_state_ = HTTP_READ_HEAD;
         } else {
             // need more data
+            if(str_buf_.size() + (end - cur_pos) > limits_.max_start_line) {
+                KM_WARNTRACE("HttpParser::parseHttp, start line is too long");
+                return onParseError(400);
+            }
             if(saveData(cur_pos, end) != KMError::NOERR) {
-                return PARSE_STATE_ERROR;
+                return onParseError(400);
             }
             cur_pos = end; // all data was consumed
             return PARSE_STATE_CONTINUE;
@@ -293,11 +355,18 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseHttp(const char*& cur_pos, c
     }
     if(HTTP_READ_HEAD == read_state_)
     {
-        while ((b_line = getLine(cur_pos, end, line, line_end)))
+        const char* line_begin = cur_pos;
+        while ((b_line = getLine(cur_pos, end, line, line_end, &colon)))
         {
+            header_bytes_ += str_buf_.size() + (cur_pos - line_begin);
+            line_begin = cur_pos;
+            if(header_bytes_ > limits_.max_header_bytes) {
+                KM_WARNTRACE("HttpParser::parseHttp, header is too large, bytes=" << header_bytes_);
+                return onParseError(431);
+            }
             if(line == line_end && bufferEmpty())
             {// blank line, header completed
-                auto const &upgrade_to = HttpHeader::getHeader(strUpgrade);
+                auto const &upgrade_to = HttpHeader::getHeader(keyUpgrade);
                 if(!upgrade_to.empty()) {
                     is_http2_ = kev::is_equal(upgrade_to, "h2c");
                     KM_INFOTRACE("HttpParser::onHeaderComplete, Upgrade="<<upgrade_to);
@@ -308,6 +377,7 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseHttp(const char*& cur_pos, c
                     HttpHeader::processHeader(status_code_, method_);
                 }
                 header_complete_ = true;
+                checkFormBody();
                 if(hasBody()) {
                     read_state_ = HTTP_READ_BODY;
                 } else {
@@ -325,12 +395,23 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseHttp(const char*& cur_pos, c
                 }
                 break;
             }
-            parseHeaderLine(line, line_end);
+            if(parseHeaderLine(line, line_end, colon) != KMError::NOERR) {
+                KM_WARNTRACE("HttpParser::parseHttp, invalid header");
+                return onParseError(400);
+            }
+            if(headerCount() > limits_.max_header_count) {
+                KM_WARNTRACE("HttpParser::parseHttp, too many headers");
+                return onParseError(431);
+            }
         }
         if(HTTP_READ_HEAD == read_state_)
         {// need more data
+            if(header_bytes_ + str_buf_.size() + (end - cur_pos) > limits_.max_header_bytes) {
+                KM_WARNTRACE("HttpParser::parseHttp, header is too large");
+                return onParseError(431);
+            }
             if(saveData(cur_pos, end) != KMError::NOERR) {
-                return PARSE_STATE_ERROR;
+                return onParseError(431);
             }
             cur_pos = end; // all data was consumed
             return PARSE_STATE_CONTINUE;
@@ -396,7 +477,9 @@ bool HttpParser::Impl::parseStartLine(const char* line, const char* line_end)
             return false;
         }
         version_.assign(p_line, p_end);
-        decodeUrl();
+        if(!decodeUrl()) {
+            return false;
+        }
         parseUrl();
     } else {// response
         version_.swap(str);
@@ -408,29 +491,39 @@ bool HttpParser::Impl::parseStartLine(const char* line, const char* line_end)
     return true;
 }
 
-bool HttpParser::Impl::parseHeaderLine(const char* line, const char* line_end)
+KMError HttpParser::Impl::parseHeaderLine(const char* line, const char* line_end, const char* colon)
 {
     const char* p_line = line;
     const char* p_end = line_end;
+    const char* p = colon ? colon : line_end;
     if(!str_buf_.empty()) {
+        // the line was split, the colon may be in the saved part
         str_buf_.append(line, line_end);
         p_line = str_buf_.c_str();
         p_end = p_line + str_buf_.length();
+        p = std::find(p_line, p_end, ':');
     }
-    
-    std::string str_name;
-    std::string str_value;
-    const char* p = std::find(p_line, p_end, ':');
-    if(p == p_end) {
+    if(p >= p_end) {
         clearBuffer();
-        return false;
+        return KMError::NOERR;
     }
-    str_name.assign(p_line, p);
-    p_line = p + 1;
-    str_value.assign(p_line, p_end);
+    // trim the name and value here, so they are not scanned again by addHeaderValue
+    const char* name_begin = p_line;
+    const char* name_end = p;
+    while (name_begin < name_end && *name_begin == ' ') ++name_begin;
+    while (name_end > name_begin && *(name_end - 1) == ' ') --name_end;
+    const char* value_begin = p + 1;
+    const char* value_end = p_end;
+    while (value_begin < value_end && (*value_begin == ' ' || *value_begin == '\t')) ++value_begin;
+    while (value_end > value_begin && (*(value_end - 1) == ' ' || *(value_end - 1) == '\t')) --value_end;
+    if(name_begin == name_end) {
+        clearBuffer();
+        return KMError::NOERR;
+    }
+    // the strings are created on demand
+    auto ret = HttpHeader::addHeaderRef(name_begin, name_end - name_begin, value_begin, value_end - value_begin);
     clearBuffer();
-    addHeaderValue(std::move(str_name), std::move(str_value));
-    return true;
+    return ret;
 }
 
 HttpParser::Impl::ParseState HttpParser::Impl::parseChunk(const char*& cur_pos, const char* end)
@@ -443,30 +536,47 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseChunk(const char*& cur_pos,
         switch (chunk_state_)
         {
             case CHUNK_READ_SIZE:
-            {
-                b_line = getLine(cur_pos, end, p_line, p_end);
-                if(!b_line)
-                {// need more data, save remain data.
-                    if(saveData(cur_pos, end) != KMError::NOERR) {
-                        return PARSE_STATE_ERROR;
+            {// the size is accumulated across buffers, no copy is needed
+                int v = -1;
+                while (cur_pos < end && (v = hexDigitValue(*cur_pos)) >= 0) {
+                    if(chunk_size_ > (SIZE_MAX >> 4)) {
+                        KM_ERRTRACE("HttpParser::parseChunk, chunk size overflow");
+                        return onParseError(400);
                     }
-                    cur_pos = end;
+                    chunk_size_ = (chunk_size_ << 4) | static_cast<size_t>(v);
+                    ++chunk_bytes_read_;
+                    ++cur_pos;
+                }
+                if(cur_pos == end) {
                     return PARSE_STATE_CONTINUE;
                 }
-                std::string str;
-                if(!str_buf_.empty()) {
-                    str.swap(str_buf_);
-                    clearBuffer();
+                if(0 == chunk_bytes_read_) {
+                    KM_ERRTRACE("HttpParser::parseChunk, invalid chunk size");
+                    return onParseError(400);
+                }
+                // count the extension bytes from now on
+                chunk_bytes_read_ = 0;
+                chunk_state_ = CHUNK_READ_EXT;
+                break;
+            }
+            case CHUNK_READ_EXT:
+            {// need not parse chunk extension, skip to LF
+                auto *lf = static_cast<const char*>(memchr(cur_pos, LF, end - cur_pos));
+                chunk_bytes_read_ += (lf ? lf : end) - cur_pos;
+                if(chunk_bytes_read_ > limits_.max_chunk_extension) {
+                    KM_ERRTRACE("HttpParser::parseChunk, chunk extension is too long");
+                    return onParseError(400);
+                }
+                if(!lf) {
+                    cur_pos = end;
+                    return PARSE_STATE_CONTINUE;
                 }
-                str.append(p_line, p_end);
-                // need not parse chunk extension
-                chunk_size_ = strtol(str.c_str(), NULL, 16);
-                //KM_INFOTRACE("HttpParser::parseChunk, chunk_size="<<chunk_size_);
+                cur_pos = lf + 1;
+                chunk_bytes_read_ = 0;
                 if(0 == chunk_size_)
                 {// chunk completed
                     chunk_state_ = CHUNK_READ_TRAILER;
                 } else {
-                    chunk_bytes_read_ = 0;
                     chunk_state_ = CHUNK_READ_DATA;
                 }
                 break;
@@ -479,8 +589,14 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseChunk(const char*& cur_pos,
                     size_t notify_len = chunk_size_ - chunk_bytes_read_;
                     total_bytes_read_ += notify_len;
                     chunk_bytes_read_ = chunk_size_ = 0; // reset
-                    chunk_state_ = CHUNK_READ_DATA_CR;
                     cur_pos += notify_len;
+                    if(end - cur_pos >= 2 && cur_pos[0] == CR && cur_pos[1] == LF) {
+                        // the CRLF is in this buffer too
+                        cur_pos += 2;
+                        chunk_state_ = CHUNK_READ_SIZE;
+                    } else {
+                        chunk_state_ = CHUNK_READ_DATA_CR;
+                    }
                     DESTROY_DETECTOR_SETUP();
                     onBodyData(notify_data, notify_len);
                     DESTROY_DETECTOR_CHECK(PARSE_STATE_DESTROYED);
@@ -498,8 +614,7 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseChunk(const char*& cur_pos,
             {
                 if(*cur_pos != CR) {
                     KM_ERRTRACE("HttpParser::parseChunk, can not find data CR");
-                    read_state_ = HTTP_READ_ERROR;
-                    return PARSE_STATE_ERROR;
+                    return onParseError(400);
                 }
                 ++cur_pos;
                 chunk_state_ = CHUNK_READ_DATA_LF;
@@ -509,8 +624,7 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseChunk(const char*& cur_pos,
             {
                 if(*cur_pos != LF) {
                     KM_ERRTRACE("HttpParser::parseChunk, can not find data LF");
-                    read_state_ = HTTP_READ_ERROR;
-                    return PARSE_STATE_ERROR;
+                    return onParseError(400);
                 }
                 ++cur_pos;
                 chunk_state_ = CHUNK_READ_SIZE;
@@ -518,8 +632,15 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseChunk(const char*& cur_pos,
             }
             case CHUNK_READ_TRAILER:
             {
+                auto *line_begin = cur_pos;
                 b_line = getLine(cur_pos, end, p_line, p_end);
+                size_t line_bytes = str_buf_.size() + ((b_line ? cur_pos : end) - line_begin);
+                if(header_bytes_ + line_bytes > limits_.max_header_bytes) {
+                    KM_ERRTRACE("HttpParser::parseChunk, trailer is too large");
+                    return onParseError(431);
+                }
                 if(b_line) {
+                    header_bytes_ += line_bytes;
                     if(p_line == p_end && bufferEmpty()) {
                         // blank line, http completed
                         read_state_ = HTTP_READ_DONE;
@@ -529,7 +650,7 @@ HttpParser::Impl::ParseState HttpParser::Impl::parseChunk(const char*& cur_pos,
                     clearBuffer(); // discard trailer
                 } else { // need more data
                     if(saveData(cur_pos, end) != KMError::NOERR) {
-                        return PARSE_STATE_ERROR;
+                        return onParseError(431);
                     }
                     cur_pos = end; // all data was consumed
                     return PARSE_STATE_CONTINUE;
@@ -547,9 +668,9 @@ void HttpParser::Impl::onHeaderComplete()
         KM_INFOTRACE("HttpParser::onHeaderComplete, Content-Length="<<content_length_);
     }
     if(is_chunked_) {
-        KM_INFOTRACE("HttpParser::onHeaderComplete, Transfer-Encoding=" << getHeaderValue(strTransferEncoding));
+        KM_INFOTRACE("HttpParser::onHeaderComplete, Transfer-Encoding=" << HttpHeader::getHeader(keyTransferEncoding));
     }
-    auto const &contentEncoding = getHeaderValue(strContentEncoding);
+    auto const &contentEncoding = HttpHeader::getHeader(keyContentEncoding);
     if (!contentEncoding.empty()) {
         KM_INFOTRACE("HttpParser::onHeaderComplete, Content-Encoding=" << contentEncoding);
     }
@@ -559,14 +680,26 @@ void HttpParser::Impl::onHeaderComplete()
 
 void HttpParser::Impl::onBodyData(const char* data, size_t len)
 {
+    if (form_parser_) {
+        parseFormBody(data, len);
+    }
     if (data_cb_) {
-        KMBuffer buf(data, len, len);
+        KMBuffer buf;
+        auto *rd_ptr = cur_buf_ ? static_cast<const char*>(cur_buf_->readPtr()) : nullptr;
+        if (rd_ptr && data >= rd_ptr && data + len <= rd_ptr + cur_buf_->length()) {
+            cur_buf_->sliceSelf(buf, data - rd_ptr, len);
+        } else {
+            buf.reset(const_cast<char*>(data), len, len);
+        }
         data_cb_(buf);
     }
 }
 
 void HttpParser::Impl::onBodyData(KMBuffer &buf)
 {
+    for (auto it = buf.begin(); form_parser_ && it != buf.end(); ++it) {
+        parseFormBody(static_cast<const char*>(it->readPtr()), it->length());
+    }
     if (data_cb_) {
         data_cb_(buf);
     }
@@ -575,88 +708,137 @@ void HttpParser::Impl::onBodyData(KMBuffer &buf)
 void HttpParser::Impl::onComplete()
 {
     KM_INFOTRACE("HttpParser::onComplete");
+    if (form_parser_) {
+        ensureParams();
+        form_parser_->finish(params_);
+        form_parser_.reset();
+    }
     if(event_cb_) event_cb_(HttpEvent::COMPLETE);
 }
 
 bool HttpParser::Impl::decodeUrl()
 {
-    std::string new_url;
-    size_t i = 0;
-    auto len = url_.length();
-    const char * p_str = url_.c_str();
-    while (i < len)
+    if (url_.empty()) {
+        return true;
+    }
+    char * begin = &url_[0];
+    char * end = begin + url_.length();
+    const char * p = findUrlSpecial(begin, end);
+    if (p == end) {
+        // nothing to decode, this is the common case
+        return true;
+    }
+    // decode in place, the decoded url is never longer than the original
+    char * out = begin + (p - begin);
+    while (p < end)
     {
-        switch (p_str[i])
+        switch (*p)
         {
             case '+':
-                new_url.append(1, ' ');
-                i++;
+                *out++ = ' ';
+                ++p;
                 break;
                 
             case '%':
-                if (p_str[i + 1] == '%') {
-                    new_url.append(1, '%');
-                    i += 2;
-                } else if(p_str[i + 1] == '\0') {
-                    return false;
+            {
+                int ch1 = end - p > 2 ? hexDigitValue(p[1]) : -1;
+                int ch2 = ch1 >= 0 ? hexDigitValue(p[2]) : -1;
+                if (end - p > 1 && p[1] == '%') {
+                    *out++ = '%';
+                    p += 2;
+                } else if (ch2 >= 0) {
+                    *out++ = static_cast<char>(ch1*16 + ch2);
+                    p += 3;
                 } else {
-                    char ch1 = p_str[i + 1];
-                    char ch2 = p_str[i + 2];
-                    ch1 = ch1 >= 'A' ? ((ch1 & 0xdf) - 'A' + 10) : ch1 - '0';
-                    ch2 = ch2 >= 'A' ? ((ch2 & 0xdf) - 'A' + 10) : ch2 - '0';
-                    new_url.append(1, (char)(ch1*16 + ch2));
-                    i += 3;
+                    // invalid escape, keep it as is
+                    *out++ = *p++;
                 }
                 break;
+            }
                 
             default:
-                new_url.append(1, p_str[i++]);
-                break;
+                KM_WARNTRACE("HttpParser::decodeUrl, invalid character in url");
+                return false;
+        }
+        // copy the plain run up to next special byte
+        auto next = findUrlSpecial(p, end);
+        if (out != p) {
+            memmove(out, p, next - p);
         }
+        out += next - p;
+        p = next;
     }
     
-    std::swap(url_, new_url);
+    url_.resize(out - begin);
     return true;
 }
 
 bool HttpParser::Impl::parseUrl()
 {
+    if(!url_.empty() && url_[0] == '/') {
+        // origin-form, split it directly so the strings keep their capacity
+        auto *url_end = url_.data() + url_.size();
+        auto *p = findEither(url_.data(), url_end, '?', '#');
+        auto pos = p != url_end ? static_cast<std::string::size_type>(p - url_.data()) : std::string::npos;
+        url_path_.assign(url_, 0, pos);
+        url_query_.clear();
+        if(pos != std::string::npos && url_[pos] == '?') {
+            auto qend = url_.find('#', pos + 1);
+            url_query_.assign(url_, pos + 1, qend == std::string::npos ? std::string::npos : qend - pos - 1);
+        }
+        params_parsed_ = false;
+        return true;
+    }
     Uri uri;
     if(!uri.parse(url_)) {
         return false;
     }
     url_path_ = uri.getPath();
     url_query_ = uri.getQuery();
-    const std::string& query = uri.getQuery();
-    std::string::size_type pos = 0;
-    while (true) {
-        auto pos1 = query.find('=', pos);
-        if(pos1 == std::string::npos){
-            break;
-        }
-        std::string name(query.begin()+pos, query.begin()+pos1);
-        pos = pos1 + 1;
-        pos1 = query.find('&', pos);
-        if(pos1 == std::string::npos){
-            std::string value(query.begin()+pos, query.end());
-            addParamValue(std::move(name), std::move(value));
-            break;
-        }
-        std::string value(query.begin()+pos, query.begin()+pos1);
-        pos = pos1 + 1;
-        addParamValue(std::move(name), std::move(value));
-    }
-    
+    params_parsed_ = false;
     return true;
 }
 
-void HttpParser::Impl::addParamValue(std::string name, std::string value)
+void HttpParser::Impl::ensureParams() const
 {
-    if(!name.empty()) {
-        param_map_[std::move(name)] = std::move(value);
+    if(!params_parsed_) {
+        params_parsed_ = true;
+        params_.parseQuery(url_query_);
+    }
+}
+
+void HttpParser::Impl::checkFormBody()
+{
+    if(limits_.max_form_bytes == 0 || !isRequest() || !hasBody() ||
+       HttpHeader::hasHeader(keyContentEncoding)) {
+        return; // form parsing is not enabled
+    }
+    if(hasContentLength() && getContentLength() > limits_.max_form_bytes) {
+        KM_WARNTRACE("HttpParser::checkFormBody, form body is too large, length=" << getContentLength());
+        return;
+    }
+    auto const &content_type = HttpHeader::getHeader(keyContentType);
+    static const std::string kFormType = "application/x-www-form-urlencoded";
+    if(kev::is_equal(content_type, kFormType, static_cast<int>(kFormType.size()))) {
+        form_parser_.reset(new FormUrlEncodedParser(limits_.max_form_bytes, limits_.max_form_fields));
+    }
+}
+
+void HttpParser::Impl::parseFormBody(const char* data, size_t len)
+{
+    ensureParams();
+    if (form_parser_->parse(data, len, params_) != KMError::NOERR) {
+        KM_WARNTRACE("HttpParser::parseFormBody, form body exceeds the limits");
+        form_parser_.reset();
     }
 }
 
+void HttpParser::Impl::addParamValue(std::string name, std::string value)
+{
+    ensureParams();
+    params_.add(std::move(name), std::move(value));
+}
+
 void HttpParser::Impl::addHeaderValue(std::string name, std::string value)
 {
     kev::trim_left(name, ' ');
@@ -670,11 +852,8 @@ void HttpParser::Impl::addHeaderValue(std::string name, std::string value)
 
 const std::string& HttpParser::Impl::getParamValue(const std::string& name) const
 {
-    auto it = param_map_.find(name);
-    if (it != param_map_.end()) {
-        return (*it).second;
-    }
-    return EmptyString;
+    ensureParams();
+    return params_.get(name);
 }
 
 const std::string& HttpParser::Impl::getHeaderValue(const std::string& name) const
@@ -684,16 +863,13 @@ const std::string& HttpParser::Impl::getHeaderValue(const std::string& name) con
 
 void HttpParser::Impl::forEachParam(const EnumerateCallback &cb) const
 {
-    for (auto &kv : param_map_) {
-        if (!cb(kv.first, kv.second)) {
-            break;
-        }
-    }
+    ensureParams();
+    params_.forEach(cb);
 }
 
 void HttpParser::Impl::forEachHeader(const EnumerateCallback &cb) const
 {
-    for (auto &kv : header_vec_) {
+    for (auto &kv : getHeaders()) {
         if (!cb(kv.first, kv.second)) {
             break;
         }
@@ -725,9 +901,10 @@ void HttpParser::Impl::setStatusCode(int status_code)
     status_code_ = status_code;
 }
 
-bool HttpParser::Impl::getLine(const char*& cur_pos, const char* end, const char*& line, const char*& line_end)
+bool HttpParser::Impl::getLine(const char*& cur_pos, const char* end, const char*& line, const char*& line_end,
+                               const char** colon)
 {
-    const char* lf = std::find(cur_pos, end, LF);
+    const char* lf = findLineEnd(cur_pos, end, colon);
     if(lf == end) {
         return false;
     }
@@ -736,6 +913,9 @@ bool HttpParser::Impl::getLine(const char*& cur_pos, const char* end, const char
     cur_pos = lf + 1;
     if(line != line_end && *(line_end - 1) == CR) {
         --line_end;
+    } else if(line == line_end && !str_buf_.empty() && str_buf_.back() == CR) {
+        // CR and LF are split across buffers
+        str_buf_.pop_back();
     }
     return true;
 }
@@ -28,11 +28,13 @@
 #include "libkev/src/utils/utils.h"
 #include "libkev/src/utils/DestroyDetector.h"
 #include "HttpHeader.h"
+#include "HttpParams.h"
 
 #include <string>
 #include <map>
 #include <vector>
 #include <functional>
+#include <memory>
 
 KUMA_NS_BEGIN
 
@@ -42,6 +44,7 @@ public:
     using DataCallback = HttpParser::DataCallback;
     using EventCallback = HttpParser::EventCallback;
     using EnumerateCallback = std::function<bool(const std::string&, const std::string&)>;
+    using Limits = HttpParser::Limits;
     
     Impl() : HttpHeader(false) {}
     Impl(const Impl& other);
@@ -66,6 +69,9 @@ public:
     bool error() const;
     bool paused() const { return paused_; }
     bool isUpgradeTo(const std::string& protocol) const;
+    void setLimits(const Limits &limits) { limits_ = limits; }
+    const Limits& getLimits() const { return limits_; }
+    int getErrorStatus() const;
     
     int getStatusCode() const { return status_code_; }
     const std::string& getLocation() const { return getHeaderValue("Location"); }
@@ -113,7 +119,7 @@ private:
         CHUNK_READ_DATA,
         CHUNK_READ_DATA_CR,
         CHUNK_READ_DATA_LF,
-        CHUNK_READ_DATACRLF,
+        CHUNK_READ_EXT,
         CHUNK_READ_TRAILER
     }ChunkReadState;
     
@@ -121,12 +127,19 @@ private:
     ParseState parse(const char* data, size_t len, int *bytes_read);
     ParseState parseHttp(const char*& cur_pos, const char* end);
     bool parseStartLine(const char* line, const char* line_end);
-    bool parseHeaderLine(const char* line, const char* line_end);
+    // the line without colon is ignored, error if the header value is invalid
+    KMError parseHeaderLine(const char* line, const char* line_end, const char* colon);
     ParseState parseChunk(const char*& cur_pos, const char* end);
-    bool getLine(const char*& cur_pos, const char* end, const char*& line, const char*& line_end);
+    ParseState onParseError(int status);
+    bool getLine(const char*& cur_pos, const char* end, const char*& line, const char*& line_end,
+                 const char** colon = nullptr);
     
     bool decodeUrl();
     bool parseUrl();
+    // the query is split on first access of params
+    void ensureParams() const;
+    void checkFormBody();
+    void parseFormBody(const char* data, size_t len);
     
     bool hasBody();
     bool readEOF();
@@ -146,6 +159,8 @@ private:
     bool                is_request_{ true };
     
     std::string         str_buf_;
+    // the KMBuffer being parsed, body data is delivered as a slice of it
+    const KMBuffer*     cur_buf_{ nullptr };
     
     int                 read_state_{ HTTP_READ_LINE };
     bool                header_complete_{ false };
@@ -153,17 +168,26 @@ private:
     
     int                 chunk_state_{ CHUNK_READ_SIZE };
     size_t              chunk_size_{ 0 };
+    // the hex digits of chunk size are counted here in CHUNK_READ_SIZE
     size_t              chunk_bytes_read_{ 0 };
     
     size_t              total_bytes_read_{ 0 };
     
+    Limits              limits_;
+    // the bytes of start line, headers and trailers of current message
+    size_t              header_bytes_{ 0 };
+    int                 error_status_{ 0 };
+    
     // request
     std::string         method_;
     std::string         url_;
     std::string         version_;
     std::string         url_path_;
     std::string         url_query_;
-    HeaderMap           param_map_;
+    mutable HttpParams  params_;
+    mutable bool        params_parsed_{ false };
+    // the fields of application/x-www-form-urlencoded body are added to params_
+    std::unique_ptr<FormUrlEncodedParser> form_parser_;
     
     // response
     int                 status_code_{ 0 };
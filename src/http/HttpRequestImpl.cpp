@@ -58,6 +58,8 @@ KMError HttpRequest::Impl::sendRequest(std::string method, std::string url)
     if(!uri_.parse(url_)) {
         return KMError::INVALID_PARAM;
     }
+    // before the default Cache-Control and Pragma are added
+    cache_enabled_ = HttpCache::isCacheable(method_, getRequestHeader().getHeaders());
     checkRequestHeaders();
     
     if (compression_enable_ && !req_encoding_type_.empty()) {
@@ -84,7 +86,7 @@ void HttpRequest::Impl::checkRequestHeaders()
         addHeader("Accept", "*/*");
     }
     
-    auto content_type = req_header.getHeader(strContentType);
+    auto content_type = req_header.getHeader(keyContentType);
     if (content_type.empty()) {
         content_type = "application/octet-stream";
         addHeader(strContentType, content_type);
@@ -96,33 +98,33 @@ void HttpRequest::Impl::checkRequestHeaders()
         });
     }
     
-    if (!req_header.hasHeader(strUserAgent)) {
+    if (!req_header.hasHeader(keyUserAgent)) {
         addHeader(strUserAgent, UserAgent);
     }
     if (!isHttp2()) {
         addHeader(strHost, uri_.getHost());
     }
-    if (!req_header.hasHeader(strCacheControl)) {
+    if (!req_header.hasHeader(keyCacheControl)) {
         addHeader(strCacheControl, "no-cache");
     }
     if (!req_header.hasHeader("Pragma")) {
         addHeader("Pragma", "no-cache");
     }
-    if (!req_header.hasHeader(strAcceptEncoding)) {
+    if (!req_header.hasHeader(keyAcceptEncoding)) {
         addHeader(strAcceptEncoding, "gzip, deflate");
     }
     /*if (!isHttp2() && !req_header.hasHeader("TE")) {
      addHeader("TE", "gzip, deflate");
      }*/
     if (kev::is_equal(method_, "POST") &&
-        !req_header.hasHeader(strTransferEncoding) &&
-        !req_header.hasHeader(strContentLength))
+        !req_header.hasHeader(keyTransferEncoding) &&
+        !req_header.hasHeader(keyContentLength))
     {
         addHeader(strContentLength, "0");
     }
     
     req_encoding_type_.clear();
-    auto encoding = req_header.getHeader(strContentEncoding);
+    auto encoding = req_header.getHeader(keyContentEncoding);
     if (!encoding.empty()) {
         // caller do compression by itself
         compression_enable_ = false;
@@ -169,11 +171,10 @@ void HttpRequest::Impl::checkRequestHeaders()
 
 void HttpRequest::Impl::checkResponseHeaders()
 {
-    auto &rsp_header = getResponseHeader();
-    
-    rsp_encoding_type_ = rsp_header.getHeader(strContentEncoding);
+    // the headers of cached response are not in response header
+    rsp_encoding_type_ = getHeaderValue(strContentEncoding);
     if (rsp_encoding_type_.empty() && !isHttp2()) {
-        auto encodings = rsp_header.getHeader(strTransferEncoding);
+        auto encodings = getHeaderValue(strTransferEncoding);
         kev::for_each_token(encodings, ',', [this] (const std::string &str) {
             if (!kev::is_equal(str, strChunked)) {
                 rsp_encoding_type_ = str;
@@ -349,7 +350,12 @@ int HttpRequest::Impl::sendData(const KMBuffer &buf)
 
 std::string HttpRequest::Impl::getCacheKey()
 {
-    std::string cache_key = uri_.getHost() + uri_.getPath();
+    std::string cache_key = uri_.getScheme() + "://" + uri_.getHost();
+    if (!uri_.getPort().empty()) {
+        cache_key += ":";
+        cache_key += uri_.getPort();
+    }
+    cache_key += uri_.getPath();
     if (!uri_.getQuery().empty()) {
         cache_key += "?";
         cache_key += uri_.getQuery();
@@ -368,13 +374,97 @@ void HttpRequest::Impl::reset()
     compression_enable_ = true;
     compression_finish_ = false;
     compression_buffer_.clear();
+    cache_enabled_ = false;
+    cache_revalidating_ = false;
+    cache_refetching_ = false;
+    cache_storing_ = false;
+    cache_body_.reset();
+    cache_body_size_ = 0;
+    rsp_cache_.reset();
     if (getState() == State::COMPLETE) {
         setState(State::WAIT_FOR_REUSE);
     }
 }
 
+bool HttpRequest::Impl::checkHttpCache()
+{
+    cache_revalidating_ = false;
+    cache_storing_ = false;
+    if (!cache_enabled_) {
+        return false;
+    }
+    cache_key_ = getCacheKey();
+    
+    auto &cache = HttpCache::instance();
+    auto const &req_headers = getRequestHeader().getHeaders();
+    auto rsp = cache.getCache(cache_key_, req_headers);
+    if (rsp) {
+        // cache hit
+        setState(State::RECVING_RESPONSE);
+        setCacheResponse(std::move(rsp));
+        return true;
+    }
+    std::string etag, last_modified;
+    if (cache.getValidators(cache_key_, req_headers, etag, last_modified)) {
+        KM_INFOXTRACE("checkHttpCache, revalidate, etag=" << etag << ", last_modified=" << last_modified);
+        if (!etag.empty()) {
+            addHeader("If-None-Match", std::move(etag));
+        }
+        if (!last_modified.empty()) {
+            addHeader("If-Modified-Since", std::move(last_modified));
+        }
+        cache_revalidating_ = true;
+    }
+    return false;
+}
+
+void HttpRequest::Impl::setCacheResponse(HttpCache::ResponsePtr rsp)
+{
+    rsp_cache_age_ = std::to_string(rsp->getAge(steady_clock::now()));
+    rsp_cache_ = std::move(rsp);
+}
+
+const std::string& HttpRequest::Impl::getCacheHeaderValue(const std::string &name) const
+{
+    if (kev::is_equal(name, "Age")) {
+        return rsp_cache_age_;
+    }
+    auto *value = rsp_cache_->getHeader(name);
+    return value ? *value : EmptyString;
+}
+
+void HttpRequest::Impl::checkCacheResponse()
+{
+    auto status_code = getStatusCode();
+    auto &rsp_header = getResponseHeader();
+    if (cache_revalidating_ && status_code == 304) {
+        auto rsp = HttpCache::instance().updateCache(cache_key_, rsp_header.getHeaders());
+        if (rsp) {
+            KM_INFOXTRACE("checkCacheResponse, revalidated, status=" << rsp->status_code);
+            setCacheResponse(std::move(rsp));
+        } else {
+            // the stored response is evicted meanwhile, the 304 is not passed to
+            // application, the request is sent again when the 304 is complete
+            KM_WARNXTRACE("checkCacheResponse, stored response is gone, refetch");
+            cache_refetching_ = true;
+        }
+        return;
+    }
+    auto const &headers = rsp_header.getHeaders();
+    cache_storing_ = HttpCache::isStorable(status_code, headers) &&
+                     HttpCache::getMaxAgeOfCache(headers) >= 0;
+    cache_body_.reset();
+    cache_body_size_ = 0;
+}
+
 void HttpRequest::Impl::onResponseHeaderComplete()
 {
+    if (cache_enabled_ && !rsp_cache_) {
+        checkCacheResponse();
+        if (cache_refetching_) {
+            return;
+        }
+    }
     checkResponseHeaders();
     
     if (!rsp_encoding_type_.empty()) {
@@ -397,6 +487,24 @@ void HttpRequest::Impl::onResponseHeaderComplete()
 
 void HttpRequest::Impl::onResponseData(KMBuffer &buf)
 {
+    if (cache_refetching_) {
+        return;
+    }
+    if (cache_storing_) {
+        // save the raw data, it is decoded again when the response is taken from cache
+        auto len = buf.chainLength();
+        cache_body_size_ += len;
+        if (cache_body_size_ > HttpCache::instance().getMaxRecordSize()) {
+            cache_storing_ = false;
+            cache_body_.reset();
+        } else if (len > 0) {
+            if (cache_body_) {
+                cache_body_->append(buf.clone());
+            } else {
+                cache_body_.reset(buf.clone());
+            }
+        }
+    }
     if(data_cb_) {
         if (decompressor_) {
             Decompressor::DataBuffer dbuf;
@@ -416,10 +524,57 @@ void HttpRequest::Impl::onResponseData(KMBuffer &buf)
 
 void HttpRequest::Impl::onResponseComplete()
 {
+    if (cache_refetching_) {
+        refetchRequest();
+        return;
+    }
+    if (cache_storing_) {
+        cache_storing_ = false;
+        KMBuffer body;
+        if (cache_body_) {
+            // the received data shares the receive buffer of connection, copy it to
+            // exact-size storage so the cache is charged for what it holds
+            auto size = cache_body_->chainLength();
+            if (size > 0 && body.allocBuffer(size)) {
+                cache_body_->readChained(body.writePtr(), size);
+                body.bytesWritten(size);
+            }
+            cache_body_.reset();
+        }
+        HttpCache::instance().setCache(cache_key_, getRequestHeader().getHeaders(),
+                                       getStatusCode(), getResponseHeader().getHeaders(), body);
+    }
     setState(State::COMPLETE);
     if(response_cb_) response_cb_();
 }
 
+void HttpRequest::Impl::refetchRequest()
+{
+    // send the request again without the validators. the default Cache-Control
+    // and Pragma are kept, so the request is not revalidated again
+    HeaderVector headers = getRequestHeader().getHeaders();
+    auto method = std::move(method_);
+    auto url = std::move(url_);
+    setState(State::COMPLETE);
+    reset();
+    getRequestHeader().reset();
+    for (auto &kv : headers) {
+        if (kev::is_equal(kv.first, "If-None-Match") ||
+            kev::is_equal(kv.first, "If-Modified-Since") ||
+            (!isHttp2() && kev::is_equal(kv.first, strHost))) {
+            // Host is added again by checkRequestHeaders
+            continue;
+        }
+        addHeader(std::move(kv.first), std::move(kv.second));
+    }
+    auto err = sendRequest(std::move(method), std::move(url));
+    if (err != KMError::NOERR) {
+        KM_ERRXTRACE("refetchRequest, failed to send request, err=" << (int)err);
+        setState(State::IN_ERROR);
+        if (error_cb_) error_cb_(err);
+    }
+}
+
 void HttpRequest::Impl::onSendReady()
 {
     if (!compression_buffer_.empty()) {
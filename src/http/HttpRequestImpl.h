@@ -28,6 +28,7 @@
 #include "Uri.h"
 #include "libkev/src/utils/kmobject.h"
 #include "HttpParserImpl.h"
+#include "HttpCache.h"
 #include "compr/compr.h"
 #include "proxy/proxydefs.h"
 
@@ -64,16 +65,22 @@ public:
     virtual const std::string& getVersion() const = 0;
     const std::string& getHeaderValue(const std::string &name) const
     {
+        if (rsp_cache_) {
+            return getCacheHeaderValue(name);
+        }
         return getResponseHeader().getHeader(name);
     }
     void forEachHeader(const EnumerateCallback &cb) const
     {
-        auto const &header = getResponseHeader();
-        for (auto &kv : header.getHeaders()) {
+        auto const &headers = rsp_cache_ ? rsp_cache_->headers : getResponseHeader().getHeaders();
+        for (auto &kv : headers) {
             if (!cb(kv.first, kv.second)) {
-                break;
+                return;
             }
         }
+        if (rsp_cache_) {
+            cb("Age", rsp_cache_age_);
+        }
     }
     
     std::string getCacheKey();
@@ -114,6 +121,20 @@ protected:
     void onResponseComplete();
     void onSendReady();
     
+    /* look up the HTTP cache, return true if a fresh response is found, it is in
+     * rsp_cache_. otherwise the validators of the stored response are added to
+     * request header for revalidation
+     */
+    bool checkHttpCache();
+    void setCacheResponse(HttpCache::ResponsePtr rsp);
+    const std::string& getCacheHeaderValue(const std::string &name) const;
+    /* refresh the stored response on 304, or start saving the response to store
+     */
+    void checkCacheResponse();
+    /* the stored response is gone when 304 is received, send the request again
+     */
+    void refetchRequest();
+    
 protected:
     State                   state_ = State::IDLE;
     
@@ -138,6 +159,19 @@ protected:
     
     bool                    compression_enable_ = true;
     bool                    compression_finish_ = false;
+    
+    bool                    cache_enabled_ = false;
+    bool                    cache_revalidating_ = false;
+    bool                    cache_refetching_ = false;
+    bool                    cache_storing_ = false;
+    std::string             cache_key_;
+    // the raw response body to be stored
+    KMBuffer::Ptr           cache_body_;
+    size_t                  cache_body_size_ = 0;
+    // the response from cache, or refreshed by 304. its headers and body are
+    // shared with the cache, Age is computed when it is taken
+    HttpCache::ResponsePtr  rsp_cache_;
+    std::string             rsp_cache_age_;
     Compressor::DataBuffer  compression_buffer_;
 };
 
@@ -20,6 +20,7 @@
  */
 
 #include "HttpResponseImpl.h"
+#include "HttpHeaderTemplate.h"
 #include "EventLoopImpl.h"
 #include "httputils.h"
 #include "libkev/src/utils/kmtrace.h"
@@ -55,7 +56,9 @@ KMError HttpResponse::Impl::sendResponse(int status_code, const std::string& des
     checkResponseHeaders();
     
     if (compression_enable_ && !rsp_encoding_type_.empty()) {
-        auto *compr = new ZLibCompressor();
+        // idle_compressor_ is always a ZLibCompressor
+        auto *compr = idle_compressor_ ?
+            static_cast<ZLibCompressor*>(idle_compressor_.release()) : new ZLibCompressor();
         compressor_.reset(compr);
         compr->setFlushFlag(Z_NO_FLUSH);
         if (compr->init(rsp_encoding_type_, 15) != KMError::NOERR) {
@@ -71,12 +74,32 @@ KMError HttpResponse::Impl::sendResponse(int status_code, const std::string& des
     return sendResponse(status_code, desc, version_);
 }
 
+KMError HttpResponse::Impl::sendResponse(const HttpHeaderTemplate::Impl &tpl, size_t content_length)
+{
+    if (getState() != State::WAIT_FOR_RESPONSE) {
+        return KMError::INVALID_STATE;
+    }
+    if (isHttp2() || !tpl.isHttp1x()) {
+        return KMError::NOT_SUPPORTED;
+    }
+    const HttpHeader &rsp_header = getResponseHeader();
+    if (!rsp_header.getHeaders().empty()) {
+        // the headers added by addHeader are not in the template
+        return KMError::INVALID_STATE;
+    }
+    // the body is sent as is
+    compression_enable_ = false;
+    
+    setState(State::SENDING_RESPONSE);
+    return sendTemplateResponse(tpl, content_length);
+}
+
 void HttpResponse::Impl::checkRequestHeaders()
 {
     rsp_encoding_type_.clear();
     is_content_encoding_ = true;
     auto &req_header = getRequestHeader();
-    auto encodings = req_header.getHeader(strAcceptEncoding);
+    auto encodings = req_header.getHeader(keyAcceptEncoding);
     if (encodings.empty() && !isHttp2()) {
         encodings = req_header.getHeader("TE");
         is_content_encoding_ = !encodings.empty();
@@ -92,9 +115,9 @@ void HttpResponse::Impl::checkRequestHeaders()
         return true;
     });
     
-    req_encoding_type_ = req_header.getHeader(strContentEncoding);
+    req_encoding_type_ = req_header.getHeader(keyContentEncoding);
     if (req_encoding_type_.empty() && !isHttp2()) {
-        encodings = req_header.getHeader(strTransferEncoding);
+        encodings = req_header.getHeader(keyTransferEncoding);
         kev::for_each_token(encodings, ',', [this] (const std::string &str) {
             if (!kev::is_equal(str, strChunked)) {
                 req_encoding_type_ = str;
@@ -112,7 +135,7 @@ void HttpResponse::Impl::checkResponseHeaders()
 {
     auto &rsp_header = getResponseHeader();
     
-    auto content_type = rsp_header.getHeader(strContentType);
+    auto content_type = rsp_header.getHeader(keyContentType);
     if (content_type.empty()) {
         content_type = "application/octet-stream";
         addHeader(strContentType, content_type);
@@ -124,7 +147,7 @@ void HttpResponse::Impl::checkResponseHeaders()
         });
     }
     
-    auto encoding = rsp_header.getHeader(strContentEncoding);
+    auto encoding = rsp_header.getHeader(keyContentEncoding);
     if (!encoding.empty()) {
         // caller do compression by itself
         compression_enable_ = false;
@@ -334,7 +357,9 @@ void HttpResponse::Impl::reset()
     rsp_encoding_type_.clear();
     rsp_complete_ = false;
     raw_bytes_sent_ = 0;
-    compressor_.reset();
+    if (compressor_) {
+        idle_compressor_ = std::move(compressor_);
+    }
     decompressor_.reset();
     compression_enable_ = true;
     compression_finish_ = false;
@@ -46,12 +46,15 @@ public:
     virtual ~Impl();
     
     virtual KMError setSslFlags(uint32_t ssl_flags) { return KMError::NOT_SUPPORTED; }
+    virtual KMError setSendBufferWatermarks(size_t high, size_t low) { return KMError::NOT_SUPPORTED; }
+    virtual KMError setZeroCopyThreshold(size_t threshold) { return KMError::NOT_SUPPORTED; }
     virtual KMError attachFd(SOCKET_FD fd, const KMBuffer *init_buf) { return KMError::NOT_SUPPORTED; }
     virtual KMError attachSocket(TcpSocket::Impl&& tcp, HttpParser::Impl&& parser, const KMBuffer *init_buf) { return KMError::NOT_SUPPORTED; }
     virtual KMError attachStream(uint32_t stream_id, const std::shared_ptr<H2ConnectionImpl> &conn) { return KMError::NOT_SUPPORTED; }
     virtual KMError addHeader(std::string name, std::string value) = 0;
     virtual KMError addHeader(std::string name, uint32_t value);
     KMError sendResponse(int status_code, const std::string& desc);
+    KMError sendResponse(const HttpHeaderTemplate::Impl &tpl, size_t content_length);
     int sendData(const void* data, size_t len);
     int sendData(const KMBuffer &buf);
     virtual void reset();
@@ -86,6 +89,7 @@ public:
     
 protected:
     virtual KMError sendResponse(int status_code, const std::string& desc, const std::string& ver) = 0;
+    virtual KMError sendTemplateResponse(const HttpHeaderTemplate::Impl &tpl, size_t content_length) { return KMError::NOT_SUPPORTED; }
     virtual bool canSendBody() const = 0;
     virtual int sendBody(const void* data, size_t len) = 0;
     virtual int sendBody(const KMBuffer &buf) = 0;
@@ -131,6 +135,8 @@ protected:
     size_t                  raw_bytes_sent_ = 0;
     std::unique_ptr<Compressor> compressor_;
     std::unique_ptr<Decompressor> decompressor_;
+    // the compressor of previous response, kept on reset since zlib state is large
+    std::unique_ptr<Compressor> idle_compressor_;
     
     std::string             req_encoding_type_;
     bool                    is_content_encoding_ = true;
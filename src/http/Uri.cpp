@@ -20,6 +20,7 @@
  */
 
 #include "Uri.h"
+#include "httputils.h"
 
 using namespace kuma;
 
@@ -44,6 +45,10 @@ bool Uri::parse(const std::string& url)
     if(url.empty()) {
         return false;
     }
+    // the Uri may be reused, the parts absent in url must be empty
+    scheme_.clear();
+    query_.clear();
+    fragment_.clear();
     auto pos = url.find("://");
     if(pos != std::string::npos) {
         scheme_.assign(url.begin(), url.begin()+pos);
@@ -59,12 +64,9 @@ bool Uri::parse(const std::string& url)
         return true;
     }
     if (url[pos] == '/') { // path
-        auto bpos = pos++;
-        for (; pos<url.size(); ++pos) {
-            if (url[pos] == '?' || url[pos] == '#') {
-                break;
-            }
-        }
+        auto bpos = pos;
+        auto *url_end = url.data() + url.size();
+        pos = findEither(url.data() + pos + 1, url_end, '?', '#') - url.data();
         path_.assign(url.begin()+bpos, url.begin()+pos);
         if (pos >= url.size()) {
             return true;
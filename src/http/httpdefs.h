@@ -44,6 +44,53 @@ const std::string strContentEncoding = "Content-Encoding";
 const std::string strProxyAuthenticate = "Proxy-Authenticate";
 const std::string strProxyAuthorization = "Proxy-Authorization";
 const std::string strProxyConnection = "Proxy-Connection";
+const std::string strConnection = "Connection";
+const std::string strAuthorization = "Authorization";
+
+/* case-insensitive FNV-1a hash of header name
+ */
+inline uint32_t hashHeaderName(const char *name, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        auto c = static_cast<uint8_t>(name[i]);
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        h = (h ^ c) * 16777619u;
+    }
+    return h;
+}
+
+/* header name with its hash computed, used to look up the headers
+ */
+class HeaderKey
+{
+public:
+    HeaderKey(const std::string &name)
+    : name_(name), hash_(hashHeaderName(name.c_str(), name.size())) {}
+    
+    const std::string& name() const { return name_; }
+    uint32_t hash() const { return hash_; }
+    
+private:
+    std::string name_;
+    uint32_t hash_;
+};
+
+// well-known headers
+const HeaderKey keyContentType{ strContentType };
+const HeaderKey keyContentLength{ strContentLength };
+const HeaderKey keyTransferEncoding{ strTransferEncoding };
+const HeaderKey keyCacheControl{ strCacheControl };
+const HeaderKey keyCookie{ strCookie };
+const HeaderKey keyHost{ strHost };
+const HeaderKey keyUpgrade{ strUpgrade };
+const HeaderKey keyAcceptEncoding{ strAcceptEncoding };
+const HeaderKey keyContentEncoding{ strContentEncoding };
+const HeaderKey keyConnection{ strConnection };
+const HeaderKey keyAuthorization{ strAuthorization };
+const HeaderKey keyUserAgent{ strUserAgent };
 
 const size_t kMinCompressSize = 200;
 
@@ -22,8 +22,55 @@
 #include "httputils.h"
 #include "libkev/src/utils/utils.h"
 
+#include <time.h>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define KUMA_HAS_SSE2
+#endif
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
 using namespace kuma;
 
+namespace {
+
+inline int firstSetBit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/* lf_mask and colon_mask are the match bits of a block starting at p, return true
+ * if the LF is found, and p points to it
+ */
+inline bool checkMasks(const char *&p, uint32_t lf_mask, uint32_t colon_mask, const char *&colon)
+{
+    int lf_pos = lf_mask ? firstSetBit(lf_mask) : 32;
+    if (colon_mask) {
+        int colon_pos = firstSetBit(colon_mask);
+        if (colon_pos < lf_pos) {
+            colon = p + colon_pos;
+        }
+    }
+    if (lf_mask) {
+        p += lf_pos;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
 KUMA_NS_BEGIN
 
 static const std::string compressed_content_types[] = {
@@ -46,5 +93,229 @@ bool isContentCompressed(const std::string &content_type)
     return false;
 }
 
+const char* findLineEnd(const char *begin, const char *end, const char **colon)
+{
+    const char *p = begin;
+    const char *c = nullptr;
+    const bool want_colon = colon != nullptr;
+#if defined(__AVX2__)
+    const __m256i lf32 = _mm256_set1_epi8('\n');
+    const __m256i colon32 = _mm256_set1_epi8(':');
+    while (end - p >= 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        uint32_t lf_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf32)));
+        uint32_t colon_mask = 0;
+        if (want_colon && !c) {
+            colon_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, colon32)));
+        }
+        if (checkMasks(p, lf_mask, colon_mask, c)) {
+            if (colon) *colon = c;
+            return p;
+        }
+        p += 32;
+    }
+#endif
+#if defined(KUMA_HAS_SSE2)
+    const __m128i lf16 = _mm_set1_epi8('\n');
+    const __m128i colon16 = _mm_set1_epi8(':');
+    while (end - p >= 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t lf_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf16)));
+        uint32_t colon_mask = 0;
+        if (want_colon && !c) {
+            colon_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, colon16)));
+        }
+        if (checkMasks(p, lf_mask, colon_mask, c)) {
+            if (colon) *colon = c;
+            return p;
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end && *p != '\n'; ++p) {
+        if (want_colon && !c && *p == ':') {
+            c = p;
+        }
+    }
+    if (colon) *colon = c;
+    return p;
+}
+
+const char* findUrlSpecial(const char *begin, const char *end)
+{
+    const char *p = begin;
+#if defined(__AVX2__)
+    const __m256i pct32 = _mm256_set1_epi8('%');
+    const __m256i plus32 = _mm256_set1_epi8('+');
+    const __m256i del32 = _mm256_set1_epi8(0x7F);
+    const __m256i space32 = _mm256_set1_epi8(0x20);
+    while (end - p >= 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        // v <= 0x20 in unsigned
+        auto ctl = _mm256_cmpeq_epi8(_mm256_max_epu8(v, space32), space32);
+        auto m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, pct32), _mm256_cmpeq_epi8(v, plus32)),
+                                 _mm256_or_si256(_mm256_cmpeq_epi8(v, del32), ctl));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        if (mask) {
+            return p + firstSetBit(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(KUMA_HAS_SSE2)
+    const __m128i pct16 = _mm_set1_epi8('%');
+    const __m128i plus16 = _mm_set1_epi8('+');
+    const __m128i del16 = _mm_set1_epi8(0x7F);
+    const __m128i space16 = _mm_set1_epi8(0x20);
+    while (end - p >= 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto ctl = _mm_cmpeq_epi8(_mm_max_epu8(v, space16), space16);
+        auto m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, pct16), _mm_cmpeq_epi8(v, plus16)),
+                              _mm_or_si128(_mm_cmpeq_epi8(v, del16), ctl));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(m));
+        if (mask) {
+            return p + firstSetBit(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end && *p != '%' && *p != '+' && !isUrlControl(*p); ++p) {
+    }
+    return p;
+}
+
+const char* findEither(const char *begin, const char *end, char c1, char c2)
+{
+    const char *p = begin;
+#if defined(__AVX2__)
+    const __m256i a32 = _mm256_set1_epi8(c1);
+    const __m256i b32 = _mm256_set1_epi8(c2);
+    while (end - p >= 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        auto m = _mm256_or_si256(_mm256_cmpeq_epi8(v, a32), _mm256_cmpeq_epi8(v, b32));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        if (mask) {
+            return p + firstSetBit(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(KUMA_HAS_SSE2)
+    const __m128i a16 = _mm_set1_epi8(c1);
+    const __m128i b16 = _mm_set1_epi8(c2);
+    while (end - p >= 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto m = _mm_or_si128(_mm_cmpeq_epi8(v, a16), _mm_cmpeq_epi8(v, b16));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(m));
+        if (mask) {
+            return p + firstSetBit(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end && *p != c1 && *p != c2; ++p) {
+    }
+    return p;
+}
+
+const signed char kHexDigitValues[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1,
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+};
+
+size_t formatChunkSizeLine(size_t chunk_size, char *buf)
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    char tmp[sizeof(size_t) * 2];
+    size_t n = 0;
+    do {
+        tmp[n++] = kHexDigits[chunk_size & 0x0F];
+        chunk_size >>= 4;
+    } while (chunk_size);
+    for (size_t i = 0; i < n; ++i) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+    return n;
+}
+
+static const char* kWeekDays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char* kMonths[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                 "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+const char* getHttpDate()
+{
+    static thread_local time_t last_time = 0;
+    static thread_local char date[kHttpDateLength + 1] = { 0 };
+    
+    auto now = time(nullptr);
+    if (now != last_time) {
+        last_time = now;
+        struct tm tm_now;
+#ifdef KUMA_OS_WIN
+        gmtime_s(&tm_now, &now);
+#else
+        gmtime_r(&now, &tm_now);
+#endif
+        snprintf(date, sizeof(date), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                 kWeekDays[tm_now.tm_wday], tm_now.tm_mday, kMonths[tm_now.tm_mon],
+                 tm_now.tm_year + 1900, tm_now.tm_hour, tm_now.tm_min, tm_now.tm_sec);
+    }
+    return date;
+}
+
+bool parseHttpDate(const std::string &str, time_t &t)
+{
+    char month[4] = { 0 };
+    int day = 0, year = 0, hour = 0, minute = 0, second = 0;
+    bool parsed = false;
+    auto comma = str.find(',');
+    if (comma != std::string::npos) {
+        // IMF-fixdate or RFC 850 date
+        auto *s = str.c_str() + comma + 1;
+        parsed = sscanf(s, " %d %3s %d %d:%d:%d", &day, month, &year, &hour, &minute, &second) == 6 ||
+                 sscanf(s, " %d-%3s-%d %d:%d:%d", &day, month, &year, &hour, &minute, &second) == 6;
+    } else {
+        // asctime date
+        parsed = sscanf(str.c_str(), "%*3s %3s %d %d:%d:%d %d", month, &day, &hour, &minute, &second, &year) == 6;
+    }
+    if (!parsed) {
+        return false;
+    }
+    int mon = 0;
+    while (mon < 12 && !kev::is_equal(month, kMonths[mon])) {
+        ++mon;
+    }
+    if (mon == 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60 ||
+        hour < 0 || minute < 0 || second < 0 || year < 0)
+    {
+        return false;
+    }
+    if (year < 100) {
+        year += year < 70 ? 2000 : 1900;
+    }
+    // days since 1970-01-01 of the proleptic Gregorian calendar
+    int y = mon < 2 ? year - 1 : year;
+    int m = mon < 2 ? mon + 13 : mon + 1;
+    int64_t days = 365LL * y + y / 4 - y / 100 + y / 400 + (153 * (m - 3) + 2) / 5 + day - 719469;
+    t = static_cast<time_t>(days * 86400 + hour * 3600 + minute * 60 + second);
+    return true;
+}
+
 KUMA_NS_END
 
@@ -23,10 +23,47 @@
 
 #include "httpdefs.h"
 #include <string>
+#include <time.h>
 
 KUMA_NS_BEGIN
 
 bool isContentCompressed(const std::string &content_type);
 
+/* find the first LF in [begin, end), return end if not found. if colon is not null,
+ * it is set to the first ':' before the LF, or nullptr if there is none.
+ * the buffer is scanned with SSE2/AVX2 when available
+ */
+const char* findLineEnd(const char *begin, const char *end, const char **colon = nullptr);
+
+/* find the first byte in [begin, end) that needs decoding ('%' or '+') or is not
+ * allowed in url (control characters and space), return end if there is none
+ */
+const char* findUrlSpecial(const char *begin, const char *end);
+inline bool isUrlControl(char c) { return static_cast<unsigned char>(c) <= 0x20 || c == 0x7F; }
+
+/* find the first c1 or c2 in [begin, end), return end if not found */
+const char* findEither(const char *begin, const char *end, char c1, char c2);
+
+/* current time in IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT". it is formatted
+ * once per second per thread
+ */
+const size_t kHttpDateLength = 29;
+const char* getHttpDate();
+
+/* parse the HTTP-date in IMF-fixdate, RFC 850 or asctime format to seconds since epoch
+ */
+bool parseHttpDate(const std::string &str, time_t &t);
+
+/* the value of hex digit, or -1 if it is not a hex digit
+ */
+extern const signed char kHexDigitValues[256];
+inline int hexDigitValue(char c) { return kHexDigitValues[static_cast<unsigned char>(c)]; }
+
+/* write the chunk size line "<hex>\r\n" to buf, return its length. buf must have
+ * kMaxChunkSizeLineLength bytes at least
+ */
+const size_t kMaxChunkSizeLineLength = sizeof(size_t) * 2 + 2;
+size_t formatChunkSizeLine(size_t chunk_size, char *buf);
+
 KUMA_NS_END
 
@@ -54,6 +54,7 @@ public:
     ~H2ConnectionImpl();
     
     KMError setSslFlags(uint32_t ssl_flags) { return tcp_conn_.setSslFlags(ssl_flags); }
+    KMError setCorkEnabled(bool enabled) { return tcp_conn_.setCorkEnabled(enabled); }
     uint32_t getSslFlags() const { return tcp_conn_.getSslFlags(); }
     bool sslEnabled() const { return tcp_conn_.sslEnabled(); }
     KMError setProxyInfo(const ProxyInfo &proxy_info);
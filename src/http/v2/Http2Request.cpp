@@ -20,7 +20,6 @@
  */
 
 #include "Http2Request.h"
-#include "http/HttpCache.h"
 #include "H2StreamProxy.h"
 #include "libkev/src/utils/kmtrace.h"
 #include "libkev/src/utils/utils.h"
@@ -87,8 +86,8 @@ KMError Http2Request::sendRequest()
 
 int Http2Request::getStatusCode() const
 {
-    if (rsp_cache_status_ != 0) {
-        return rsp_cache_status_;
+    if (rsp_cache_) {
+        return rsp_cache_->status_code;
     } else {
         return stream_->getStatusCode();
     }
@@ -172,6 +171,14 @@ void Http2Request::onRequestComplete()
 
 void Http2Request::onComplete()
 {
+    // the body of cached response, or the response refreshed by 304
+    if (rsp_cache_ && !rsp_cache_->body.empty() && data_cb_) {
+        // shares the storage of cached body
+        KMBuffer body(rsp_cache_->body);
+        DESTROY_DETECTOR_SETUP();
+        onResponseData(body);
+        DESTROY_DETECTOR_CHECK_VOID();
+    }
     onResponseComplete();
 }
 
@@ -191,28 +198,12 @@ void Http2Request::reset()
     
     stream_->close();
     ssl_flags_ = 0;
-    rsp_cache_status_ = 0;
-    rsp_cache_body_.reset();
 }
 
 bool Http2Request::processHttpCache()
 {
-    auto const &req_header = getRequestHeader();
-    if (!HttpCache::isCacheable(method_, req_header.getHeaders())) {
-        return false;
-    }
-    std::string cache_key = getCacheKey();
-    
-    int status_code = 0;
-    HeaderVector rsp_headers;
-    KMBuffer rsp_body;
-    if (HttpCache::instance().getCache(cache_key, status_code, rsp_headers, rsp_body)) {
+    if (checkHttpCache()) {
         // cache hit
-        setState(State::RECVING_RESPONSE);
-        auto &rsp_header = getResponseHeader();
-        rsp_header.setHeaders(std::move(rsp_headers));
-        rsp_cache_status_ = status_code;
-        rsp_cache_body_.reset(rsp_body.clone());
         stream_->runOnLoopThread([this] { onCacheComplete(); });
         return true;
     }
@@ -227,11 +218,5 @@ void Http2Request::onCacheComplete()
     DESTROY_DETECTOR_SETUP();
     onResponseHeaderComplete();
     DESTROY_DETECTOR_CHECK_VOID();
-    if (rsp_cache_body_ && !rsp_cache_body_->empty() && data_cb_) {
-        DESTROY_DETECTOR_SETUP();
-        onResponseData(*rsp_cache_body_);
-        DESTROY_DETECTOR_CHECK_VOID();
-        rsp_cache_body_.reset();
-    }
-    onResponseComplete();
+    onComplete();
 }
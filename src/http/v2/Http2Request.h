@@ -85,8 +85,6 @@ protected:
     std::unique_ptr<H2StreamProxy> stream_;
     
     uint32_t                ssl_flags_ = 0;
-    int                     rsp_cache_status_ = 0;
-    KMBuffer::Ptr           rsp_cache_body_;
 };
 
 KUMA_NS_END
@@ -71,7 +71,8 @@ KMError OpAcceptor::listen(const std::string &host, uint16_t port)
     if (ret != KMError::NOERR) {
         return ret;
     }
-    // post 3 accept ops
+    // post 3 accept ops, each is posted again when it completes since the event loop
+    // has no multishot accept
     op_ctx_->postAcceptOp(loop_.lock(), fd_, ss_family_);
     op_ctx_->postAcceptOp(loop_.lock(), fd_, ss_family_);
     op_ctx_->postAcceptOp(loop_.lock(), fd_, ss_family_);
@@ -23,6 +23,13 @@
 
 #if defined(KUMA_OS_LINUX)
 # include <sys/poll.h>
+# include <netinet/udp.h>
+# ifndef SOL_UDP
+#  define SOL_UDP 17
+# endif
+# ifndef UDP_GRO
+#  define UDP_GRO 104
+# endif
 #endif
 
 KUMA_NS_USING
@@ -122,5 +129,17 @@ void RecvMsgOp::onComplete(int res)
         res = (int)buf.space();
     }
     buf.bytesWritten(res);
+#if defined(KUMA_OS_LINUX)
+    if (res > 0) {
+        for (auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int gso_size = 0;
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                segment_size = static_cast<uint16_t>(gso_size);
+                break;
+            }
+        }
+    }
+#endif
     OpBase::onComplete(res);
 }
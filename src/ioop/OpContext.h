@@ -214,6 +214,11 @@ struct RecvMsgOp : public OpBase
     iovec           iovs[1];
     iovec*          p_iovs{ nullptr };
     int             n_iovs{ 0 };
+#if defined(KUMA_OS_LINUX)
+    // receives the segment size when UDP GRO is enabled
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+#endif
+    uint16_t        segment_size{ 0 };
 
     void prepare(OpCode oc, OpContext* ctx, const sockaddr_storage *addr, int flags)
     {
@@ -234,12 +239,18 @@ struct RecvMsgOp : public OpBase
 #else
         msg.msg_iov = p_iovs;
         msg.msg_iovlen = n_iovs;
+# if defined(KUMA_OS_LINUX)
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+# else
         msg.msg_control = nullptr;
         msg.msg_controllen = 0;
+# endif
         msg.msg_flags = flags;
         msg.msg_name = &this->addr;
         msg.msg_namelen = sizeof(this->addr);
 #endif
+        segment_size = 0;
     }
 
     void onComplete(int res) override;
@@ -583,6 +594,7 @@ public:
         case OpCode::RECVMSG: {
             auto *op = (RecvMsgOp*)base;
             addr_ = op->addr;
+            segment_size_ = op->segment_size;
             auto buf = std::move(op->buf);
             appendFreeOp(base);
             if (on_recv_) on_recv_(res, std::move(buf));
@@ -616,6 +628,13 @@ public:
     {
         return addr_;
     }
+    
+    /* the segment size of last received message coalesced by UDP GRO
+     */
+    uint16_t getSegmentSize() const
+    {
+        return segment_size_;
+    }
 
 public:
     struct Deleter
@@ -819,6 +838,7 @@ protected:
     OpBase*             free_sm_ops_{ nullptr };
     OpBase*             free_rm_ops_{ nullptr };
     sockaddr_storage    addr_;
+    uint16_t            segment_size_{ 0 };
 
     std::atomic_long    refcount_{ 0 };
 
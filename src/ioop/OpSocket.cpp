@@ -28,11 +28,12 @@ using namespace kuma;
 const size_t kMaxPendingSendBytes = 1024*1024;
 const size_t kMinPendingSendBytes = 32*1024;
 const int kMaxPendingRecvOps = 1;
-const size_t kTCPRecvPacketSize = 4 * 1024;
 
 OpSocket::OpSocket(const EventLoopPtr &loop, int max_send_ops)
     : SocketBase(loop), op_ctx_(OpContext::create(loop))
     , max_pending_send_ops_(max_send_ops)
+    , max_pending_send_bytes_(kMaxPendingSendBytes)
+    , min_pending_send_bytes_(kMinPendingSendBytes)
 {
     KM_SetObjKey("OpSocket");
     //KM_INFOXTRACE("OpSocket");
@@ -139,6 +140,20 @@ int OpSocket::send(const void* data, size_t length)
     return send(buf);
 }
 
+KMError OpSocket::setSendBufferWatermarks(size_t high, size_t low)
+{
+    if (high == 0) {
+        high = kMaxPendingSendBytes;
+        low = kMinPendingSendBytes;
+    }
+    if (low > high) {
+        return KMError::INVALID_PARAM;
+    }
+    max_pending_send_bytes_ = high;
+    min_pending_send_bytes_ = low;
+    return KMError::NOERR;
+}
+
 int OpSocket::send(const iovec* iovs, int count)
 {
     if (!isReady()) {
@@ -148,7 +163,7 @@ int OpSocket::send(const iovec* iovs, int count)
     if (send_blocked_) {
         return 0;
     }
-    if (pending_send_bytes_ >= kMaxPendingSendBytes ||
+    if (pending_send_bytes_ >= max_pending_send_bytes_ ||
         (max_pending_send_ops_ > 0 && pending_send_ops_ >= max_pending_send_ops_)) {
         send_blocked_ = true;
         return 0;
@@ -179,7 +194,7 @@ int OpSocket::send(const KMBuffer &buf)
     if (send_blocked_) {
         return 0;
     }
-    if (pending_send_bytes_ >= kMaxPendingSendBytes ||
+    if (pending_send_bytes_ >= max_pending_send_bytes_ ||
         (max_pending_send_ops_ > 0 && pending_send_ops_ >= max_pending_send_ops_)) {
         send_blocked_ = true;
         return 0;
@@ -239,6 +254,26 @@ int OpSocket::receive(void* data, size_t length)
     return static_cast<int>(bytes_recv);
 }
 
+int OpSocket::receive(KMBuffer &chunk, KMBuffer &buf)
+{
+    if (!isReady()) {
+        return 0;
+    }
+    if (recvBlocked()) {
+        return 0;
+    }
+    if (recv_buf_.empty()) {
+        postRecvOp();
+        return 0;
+    }
+    // hand over the buffer of recv op, next op receives into a new buffer
+    auto bytes_recv = recv_buf_.length();
+    recv_buf_.sliceSelf(buf, 0, bytes_recv);
+    recv_buf_.reset();
+    postRecvOp();
+    return static_cast<int>(bytes_recv);
+}
+
 KMError OpSocket::pause()
 {
     paused_ = true;
@@ -260,7 +295,11 @@ bool OpSocket::postRecvOp()
         return false;
     }
     if (recv_buf_.space() == 0) {
-        recv_buf_.allocBuffer(kTCPRecvPacketSize);
+        // the buffer of recv op is handed to the reader without copying, and it is
+        // allocated from the buffer pool, so a larger one saves ops on bulk transfer.
+        // the event loop has no provided buffer ring or multishot recv, so one op with
+        // its own buffer is posted for each read
+        recv_buf_.allocBuffer(kRecvChunkSize);
     }
     auto ret = op_ctx_->postRecvOp(loop_.lock(), fd_, recv_buf_);
     if (ret == KMError::NOERR) {
@@ -319,7 +358,7 @@ void OpSocket::onSend(int res)
     }
     pending_send_bytes_ -= (uint32_t)res;
     --pending_send_ops_;
-    if (send_blocked_ && pending_send_bytes_ < kMinPendingSendBytes &&
+    if (send_blocked_ && pending_send_bytes_ <= min_pending_send_bytes_ &&
         (max_pending_send_ops_ <= 0 || pending_send_ops_ < max_pending_send_ops_)) {
         send_blocked_ = false;
         SocketBase::onSend(KMError::NOERR);
@@ -42,8 +42,19 @@ public:
     int send(const iovec* iovs, int count) override;
     int send(const KMBuffer &buf) override;
     int receive(void* data, size_t length) override;
+    int receive(KMBuffer &chunk, KMBuffer &buf) override;
+    bool ownsRecvBuffer() const override { return true; }
     KMError pause() override;
     KMError resume() override;
+    KMError setSendBufferWatermarks(size_t high, size_t low) override;
+    /* the send op already holds the KMBuffer until it is completed, but the event
+     * loop has no send_zc op, and its ops complete once while send_zc completes twice,
+     * the second one notifies that the buffer is released
+     */
+    KMError setZeroCopyThreshold(size_t threshold) override
+    {
+        return threshold > 0 ? KMError::NOT_SUPPORTED : KMError::NOERR;
+    }
     
 protected:
     KMError connect_i(const sockaddr_storage &ss_addr, uint32_t timeout_ms) override;
@@ -76,6 +87,8 @@ protected:
     int pending_recv_ops_{0};
     bool send_blocked_{false};
     const int max_pending_send_ops_;
+    size_t max_pending_send_bytes_;
+    size_t min_pending_send_bytes_;
 
     KMBuffer recv_buf_;
 
@@ -95,6 +95,46 @@ int OpUdpSocket::receive(void *data, size_t length, char *ip, size_t ip_len, uin
     return ret;
 }
 
+int OpUdpSocket::receiveBatch(Datagram *dgrams, int count)
+{
+    if (INVALID_FD == fd_) {
+        KM_ERRXTRACE("receiveBatch, invalid fd");
+        return -1;
+    }
+    if (!dgrams || count <= 0 || recvBlocked()) {
+        return 0;
+    }
+    
+    int total = 0;
+    if (!recv_buf_.empty()) {
+        // the datagram received by the posted recvmsg op
+        auto &dgram = dgrams[0];
+        if (!dgram.buf) {
+            return int(KMError::INVALID_PARAM);
+        }
+        if (recv_buf_.size() > dgram.buf->space()) {
+            return int(KMError::BUFFER_TOO_SMALL);
+        }
+        auto bytes_read = recv_buf_.read(dgram.buf->writePtr(), dgram.buf->space());
+        dgram.buf->bytesWritten(bytes_read);
+        auto ss_addr = op_ctx_->getSockAddr();
+        auto addr_len = kev::km_get_addr_length(ss_addr);
+        kev::km_get_sock_addr((struct sockaddr*)&ss_addr, addr_len, dgram.ip, sizeof(dgram.ip), &dgram.port);
+        dgram.segment_size = op_ctx_->getSegmentSize();
+        if (++total == count) {
+            return total;
+        }
+    }
+    
+    auto ret = UdpSocketBase::receiveBatch(dgrams + total, count - total);
+    if (ret == 0) {
+        postRecvOp();
+    } else if (ret < 0) {
+        return total > 0 ? total : ret;
+    }
+    return total + ret;
+}
+
 bool OpUdpSocket::postRecvOp()
 {
     if (pending_recv_ops_ >= kMaxPendingRecvOps) {
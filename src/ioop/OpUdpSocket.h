@@ -37,6 +37,7 @@ public:
     ~OpUdpSocket();
 
     int receive(void* data, size_t length, char* ip, size_t ip_len, uint16_t& port) override;
+    int receiveBatch(Datagram *dgrams, int count) override;
     
 protected:
 #if defined(KUMA_OS_WIN)
@@ -38,10 +38,13 @@ LOCAL_SRC_FILES := \
     TcpSocketImpl.cpp \
     UdpSocketImpl.cpp \
     TcpListenerImpl.cpp \
+    ServerRuntimeImpl.cpp \
     TcpConnection.cpp \
     http/Uri.cpp \
     http/HttpHeader.cpp \
+    http/HttpHeaderTemplate.cpp \
     http/HttpMessage.cpp \
+    http/HttpParams.cpp \
     http/HttpParserImpl.cpp \
     http/H1xStream.cpp \
     http/HttpRequestImpl.cpp \
@@ -49,6 +52,8 @@ LOCAL_SRC_FILES := \
     http/HttpResponseImpl.cpp \
     http/Http1xResponse.cpp \
     http/HttpCache.cpp \
+    http/HttpDiskCache.cpp \
+    http/HttpConnectionPool.cpp \
     http/httputils.cpp \
     http/v2/H2Frame.cpp \
     http/v2/FrameParser.cpp \
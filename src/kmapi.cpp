@@ -21,13 +21,18 @@
 
 #include "EventLoopImpl.h"
 #include "TcpSocketImpl.h"
+#include "SocketBase.h"
 #include "UdpSocketImpl.h"
 #include "TcpListenerImpl.h"
+#include "ServerRuntimeImpl.h"
 #include "libkev/src/TimerManager.h"
 #include "http/HttpParserImpl.h"
 #include "http/Http1xRequest.h"
 #include "http/Http1xResponse.h"
 #include "http/HttpResponseImpl.h"
+#include "http/HttpHeaderTemplate.h"
+#include "http/HttpCache.h"
+#include "http/HttpConnectionPool.h"
 #include "ws/WebSocketImpl.h"
 #include "http/v2/H2ConnectionImpl.h"
 #include "http/v2/Http2Request.h"
@@ -359,6 +364,15 @@ int TcpSocket::receive(void *data, size_t length)
     return pimpl_->receive(data, length);
 }
 
+int TcpSocket::receive(KMBuffer &buf)
+{
+    KMBuffer chunk;
+    if (!pimpl_->ownsRecvBuffer()) {
+        chunk.allocBuffer(SocketBase::kRecvChunkSize);
+    }
+    return pimpl_->receive(chunk, buf);
+}
+
 KMError TcpSocket::close()
 {
     return pimpl_->close();
@@ -374,6 +388,16 @@ KMError TcpSocket::resume()
     return pimpl_->resume();
 }
 
+KMError TcpSocket::setSendBufferWatermarks(size_t high, size_t low)
+{
+    return pimpl_->setSendBufferWatermarks(high, low);
+}
+
+KMError TcpSocket::setZeroCopyThreshold(size_t threshold)
+{
+    return pimpl_->setZeroCopyThreshold(threshold);
+}
+
 void TcpSocket::setReadCallback(EventCallback cb)
 {
     pimpl_->setReadCallback(std::move(cb));
@@ -448,6 +472,26 @@ KMError TcpListener::close()
     return pimpl_->close();
 }
 
+KMError TcpListener::setBacklog(int backlog)
+{
+    return pimpl_->setBacklog(backlog);
+}
+
+KMError TcpListener::setReusePort(bool enable)
+{
+    return pimpl_->setReusePort(enable);
+}
+
+KMError TcpListener::setAcceptBudget(uint32_t budget)
+{
+    return pimpl_->setAcceptBudget(budget);
+}
+
+KMError TcpListener::setSocketOptions(const SocketOptions &opts)
+{
+    return pimpl_->setSocketOptions(opts);
+}
+
 void TcpListener::setAcceptCallback(AcceptCallback cb)
 {
     pimpl_->setAcceptCallback(std::move(cb));
@@ -458,6 +502,71 @@ void TcpListener::setErrorCallback(ErrorCallback cb)
     pimpl_->setErrorCallback(std::move(cb));
 }
 
+TcpListener::Impl* TcpListener::pimpl() const
+{
+    return pimpl_;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+ServerRuntime::ServerRuntime(PollType poll_type)
+: pimpl_(new Impl(poll_type))
+{
+    
+}
+
+ServerRuntime::~ServerRuntime()
+{
+    delete pimpl_;
+}
+
+KMError ServerRuntime::start(const char *host, uint16_t port, size_t loop_count)
+{
+    if (!host) {
+        return KMError::INVALID_PARAM;
+    }
+    return pimpl_->start(host, port, loop_count);
+}
+
+void ServerRuntime::stop()
+{
+    pimpl_->stop();
+}
+
+KMError ServerRuntime::setBacklog(int backlog)
+{
+    return pimpl_->setBacklog(backlog);
+}
+
+KMError ServerRuntime::setAcceptBudget(uint32_t budget)
+{
+    return pimpl_->setAcceptBudget(budget);
+}
+
+KMError ServerRuntime::setSocketOptions(const SocketOptions &opts)
+{
+    return pimpl_->setSocketOptions(opts);
+}
+
+size_t ServerRuntime::getLoopCount() const
+{
+    return pimpl_->getLoopCount();
+}
+
+EventLoop* ServerRuntime::getLoop(size_t index) const
+{
+    return pimpl_->getLoop(index);
+}
+
+void ServerRuntime::setAcceptCallback(AcceptCallback cb)
+{
+    pimpl_->setAcceptCallback(std::move(cb));
+}
+
+void ServerRuntime::setErrorCallback(ErrorCallback cb)
+{
+    pimpl_->setErrorCallback(std::move(cb));
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 UdpSocket::UdpSocket(EventLoop* loop)
 : pimpl_(new Impl(EVENTLOOP_PTR(loop)))
@@ -520,11 +629,47 @@ int UdpSocket::send(const KMBuffer &buf, const char *host, uint16_t port)
     return pimpl_->send(buf, host ? host : "", port);
 }
 
+int UdpSocket::send(const KMBuffer &buf, const char *host, uint16_t port, uint16_t segment_size)
+{
+    return pimpl_->send(buf, host ? host : "", port, segment_size);
+}
+
 int UdpSocket::receive(void *data, size_t length, char *ip, size_t ip_len, uint16_t &port)
 {
     return pimpl_->receive(data, length, ip, ip_len, port);
 }
 
+int UdpSocket::receiveBatch(Datagram *dgrams, int count)
+{
+    return pimpl_->receiveBatch(dgrams, count);
+}
+
+int UdpSocket::sendBatch(const Datagram *dgrams, int count)
+{
+    return pimpl_->sendBatch(dgrams, count);
+}
+
+KMError UdpSocket::setGroEnabled(bool enable)
+{
+    return pimpl_->setGroEnabled(enable);
+}
+
+int UdpSocket::splitSegments(const KMBuffer &buf, uint16_t segment_size, KMBuffer *segs, int count)
+{
+    if (!segs || count <= 0) {
+        return 0;
+    }
+    auto length = buf.length();
+    if (segment_size == 0) {
+        segment_size = static_cast<uint16_t>(std::min<size_t>(length, UINT16_MAX));
+    }
+    int n = 0;
+    for (size_t offset = 0; offset < length && n < count; offset += segment_size) {
+        buf.sliceSelf(segs[n++], offset, segment_size);
+    }
+    return n;
+}
+
 KMError UdpSocket::close()
 {
     return pimpl_->close();
@@ -688,6 +833,16 @@ bool HttpParser::isUpgradeTo(const char* proto) const
     return pimpl_->isUpgradeTo(proto);
 }
 
+void HttpParser::setLimits(const Limits &limits)
+{
+    pimpl_->setLimits(limits);
+}
+
+int HttpParser::getErrorStatus() const
+{
+    return pimpl_->getErrorStatus();
+}
+
 int HttpParser::getStatusCode() const
 {
     return pimpl_->getStatusCode();
@@ -902,6 +1057,39 @@ HttpRequest::Impl* HttpRequest::pimpl() const
     return pimpl_;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+HttpHeaderTemplate::HttpHeaderTemplate(int status_code, const char *desc, const char *ver)
+: pimpl_(new Impl(status_code, desc ? desc : "", ver ? ver : ""))
+{
+    
+}
+
+HttpHeaderTemplate::~HttpHeaderTemplate()
+{
+    delete pimpl_;
+}
+
+KMError HttpHeaderTemplate::addHeader(const char *name, const char *value)
+{
+    if (!name || !value) {
+        return KMError::INVALID_PARAM;
+    }
+    return pimpl_->addHeader(name, value);
+}
+
+KMError HttpHeaderTemplate::addHeader(const char *name, uint32_t value)
+{
+    if (!name) {
+        return KMError::INVALID_PARAM;
+    }
+    return pimpl_->addHeader(name, std::to_string(value));
+}
+
+HttpHeaderTemplate::Impl* HttpHeaderTemplate::pimpl() const
+{
+    return pimpl_;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 HttpResponse::HttpResponse(EventLoop* loop, const char* ver)
@@ -989,6 +1177,21 @@ int HttpResponse::sendData(const KMBuffer &buf)
     return pimpl_->sendData(buf);
 }
 
+KMError HttpResponse::sendResponse(const HttpHeaderTemplate &tpl, size_t content_length)
+{
+    return pimpl_->sendResponse(*tpl.pimpl(), content_length);
+}
+
+KMError HttpResponse::setSendBufferWatermarks(size_t high, size_t low)
+{
+    return pimpl_->setSendBufferWatermarks(high, low);
+}
+
+KMError HttpResponse::setZeroCopyThreshold(size_t threshold)
+{
+    return pimpl_->setZeroCopyThreshold(threshold);
+}
+
 void HttpResponse::reset()
 {
     pimpl_->reset();
@@ -1192,6 +1395,21 @@ int WebSocket::send(const KMBuffer &buf, bool is_text, bool is_fin, uint32_t fla
     return pimpl_->send(buf, is_text, is_fin, flags);
 }
 
+KMError WebSocket::setSendBufferWatermarks(size_t high, size_t low)
+{
+    return pimpl_->setSendBufferWatermarks(high, low);
+}
+
+KMError WebSocket::setCorkEnabled(bool enabled)
+{
+    return pimpl_->setCorkEnabled(enabled);
+}
+
+KMError WebSocket::setZeroCopyThreshold(size_t threshold)
+{
+    return pimpl_->setZeroCopyThreshold(threshold);
+}
+
 KMError WebSocket::close()
 {
     return pimpl_->close();
@@ -1313,16 +1531,25 @@ KMError ProxyConnection::connect(const char *host, uint16_t port, EventCallback
 
 int ProxyConnection::send(const void* data, size_t len)
 {
+    if (pimpl_->sendBufferFull()) {
+        return 0;
+    }
     return pimpl_->send(data, len);
 }
 
 int ProxyConnection::send(const iovec* iovs, int count)
 {
+    if (pimpl_->sendBufferFull()) {
+        return 0;
+    }
     return pimpl_->send(iovs, count);
 }
 
 int ProxyConnection::send(const KMBuffer &buf)
 {
+    if (pimpl_->sendBufferFull()) {
+        return 0;
+    }
     return pimpl_->send(buf);
 }
 
@@ -1356,6 +1583,16 @@ bool ProxyConnection::sendBufferEmpty() const
     return pimpl_->sendBufferEmpty();
 }
 
+KMError ProxyConnection::setSendBufferWatermarks(size_t high, size_t low)
+{
+    return pimpl_->setSendBufferWatermarks(high, low);
+}
+
+KMError ProxyConnection::setCorkEnabled(bool enabled)
+{
+    return pimpl_->setCorkEnabled(enabled);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 H2Connection::H2Connection(EventLoop* loop)
 : pimpl_(new Impl(EVENTLOOP_PTR(loop)))
@@ -1390,6 +1627,11 @@ KMError H2Connection::setSslFlags(uint32_t ssl_flags)
 {
     return pimpl_->ptr()->setSslFlags(ssl_flags);
 }
+
+KMError H2Connection::setCorkEnabled(bool enabled)
+{
+    return pimpl_->ptr()->setCorkEnabled(enabled);
+}
 /*
 KMError H2Connection::connect(const char* host, uint16_t port, ConnectCallback cb)
 {
@@ -1491,6 +1733,26 @@ int getLogLevel()
     return kev::getTraceLevel();
 }
 
+void setHttpCacheCapacity(size_t bytes)
+{
+    HttpCache::instance().setCapacity(bytes);
+}
+
+HttpCacheStats getHttpCacheStats()
+{
+    return HttpCache::instance().getStats();
+}
+
+KMError setHttpCacheDiskTier(const char *dir, size_t capacity)
+{
+    return HttpCache::instance().setDiskTier(dir ? dir : "", capacity);
+}
+
+void setHttpConnectionPoolConfig(const HttpConnectionPoolConfig &config)
+{
+    HttpConnectionPool::setConfig(config);
+}
+
 KUMA_NS_END
 
 
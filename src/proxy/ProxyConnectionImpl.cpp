@@ -64,13 +64,14 @@ KMError ProxyConnection::Impl::connect(const std::string &host, uint16_t port, E
 {
     if (proxy_addr_.empty()) {
         TcpConnection::setDataCallback(proxy_data_cb_);
+        TcpConnection::setBufferCallback(proxy_buffer_cb_);
         TcpConnection::setWriteCallback(proxy_write_cb_);
         TcpConnection::setErrorCallback(proxy_error_cb_);
         
         return TcpConnection::connect(host, port, std::move(cb));
     } else {
-        TcpConnection::setDataCallback([this](uint8_t *data, size_t size) {
-            return onTcpData(data, size);
+        TcpConnection::setBufferCallback([this](KMBuffer &buf) {
+            return onTcpData(buf);
         });
         TcpConnection::setWriteCallback([this] (KMError) {
             onTcpWrite();
@@ -102,6 +103,7 @@ KMError ProxyConnection::Impl::connect(const std::string &host, uint16_t port, E
 KMError ProxyConnection::Impl::attachFd(SOCKET_FD fd, const KMBuffer *init_buf)
 {
     TcpConnection::setDataCallback(proxy_data_cb_);
+    TcpConnection::setBufferCallback(proxy_buffer_cb_);
     TcpConnection::setWriteCallback(proxy_write_cb_);
     TcpConnection::setErrorCallback(proxy_error_cb_);
     
@@ -111,12 +113,25 @@ KMError ProxyConnection::Impl::attachFd(SOCKET_FD fd, const KMBuffer *init_buf)
 KMError ProxyConnection::Impl::attachSocket(TcpSocket::Impl &&tcp, const KMBuffer *init_buf)
 {
     TcpConnection::setDataCallback(proxy_data_cb_);
+    TcpConnection::setBufferCallback(proxy_buffer_cb_);
     TcpConnection::setWriteCallback(proxy_write_cb_);
     TcpConnection::setErrorCallback(proxy_error_cb_);
     
     return TcpConnection::attachSocket(std::move(tcp), init_buf);
 }
 
+KMError ProxyConnection::Impl::reuseSocket(TcpSocket::Impl &&tcp)
+{
+    // the tunnel to server was established by previous connection
+    TcpConnection::setDataCallback(proxy_data_cb_);
+    TcpConnection::setBufferCallback(proxy_buffer_cb_);
+    TcpConnection::setWriteCallback(proxy_write_cb_);
+    TcpConnection::setErrorCallback(proxy_error_cb_);
+    setState(State::OPEN);
+    
+    return TcpConnection::reuseSocket(std::move(tcp));
+}
+
 KMError ProxyConnection::Impl::sendProxyRequest()
 {
     http_parser_.reset();
@@ -246,12 +261,12 @@ void ProxyConnection::Impl::onTcpConnect(KMError err)
     }
 }
 
-KMError ProxyConnection::Impl::onTcpData(uint8_t *data, size_t size)
+KMError ProxyConnection::Impl::onTcpData(KMBuffer &buf)
 {
     if (getState() == State::OPEN) {
-        onProxyData(data, size);
+        return onProxyData(buf);
     } else if (getState() == State::AUTHENTICATING) {
-        int bytes_used = http_parser_.parse((char*)data, size);
+        int bytes_used = http_parser_.parse(buf);
     }
     return KMError::NOERR;
 }
@@ -276,11 +291,14 @@ void ProxyConnection::Impl::onProxyConnect(KMError err)
     }
 }
 
-void ProxyConnection::Impl::onProxyData(uint8_t *data, size_t size)
+KMError ProxyConnection::Impl::onProxyData(KMBuffer &buf)
 {
-    if (proxy_data_cb_) {
-        proxy_data_cb_(data, size);
+    if (proxy_buffer_cb_) {
+        return proxy_buffer_cb_(buf);
+    } else if (proxy_data_cb_) {
+        return proxy_data_cb_(static_cast<uint8_t*>(buf.readPtr()), buf.length());
     }
+    return KMError::NOERR;
 }
 
 void ProxyConnection::Impl::onProxyWrite()
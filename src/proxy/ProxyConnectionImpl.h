@@ -35,6 +35,7 @@ class ProxyConnection::Impl : public TcpConnection
 public:
     using EventCallback = ProxyConnection::EventCallback;
     using DataCallback = ProxyConnection::DataCallback;
+    using BufferCallback = TcpConnection::BufferCallback;
 
     Impl(const EventLoopPtr &loop);
     virtual ~Impl();
@@ -43,14 +44,17 @@ public:
     KMError connect(const std::string &host, uint16_t port, EventCallback cb) override;
     KMError attachFd(SOCKET_FD fd, const KMBuffer *init_buf) override;
     KMError attachSocket(TcpSocket::Impl &&tcp, const KMBuffer *init_buf) override;
+    KMError reuseSocket(TcpSocket::Impl &&tcp) override;
+    const ProxyInfo& getProxyInfo() const { return proxy_info_; }
     
     void setDataCallback(DataCallback cb) override { proxy_data_cb_ = std::move(cb); }
+    void setBufferCallback(BufferCallback cb) override { proxy_buffer_cb_ = std::move(cb); }
     void setWriteCallback(EventCallback cb) override { proxy_write_cb_ = std::move(cb); }
     void setErrorCallback(EventCallback cb) override { proxy_error_cb_ = std::move(cb); }
     
 protected: // callbacks of TcpConnection
     void onTcpConnect(KMError err);
-    KMError onTcpData(uint8_t *data, size_t size);
+    KMError onTcpData(KMBuffer &buf);
     void onTcpWrite();
     void onTcpError(KMError err);
     
@@ -60,7 +64,7 @@ protected:
     KMError handleProxyResponse();
     
     void onProxyConnect(KMError err);
-    void onProxyData(uint8_t *data, size_t size);
+    KMError onProxyData(KMBuffer &buf);
     void onProxyWrite();
     void onProxyError(KMError err);
     
@@ -95,6 +99,7 @@ private:
     
     EventCallback           proxy_connect_cb_;
     DataCallback            proxy_data_cb_;
+    BufferCallback          proxy_buffer_cb_;
     EventCallback           proxy_write_cb_;
     EventCallback           proxy_error_cb_;
 };
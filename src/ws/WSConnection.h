@@ -55,8 +55,12 @@ public:
     virtual KMError setSslFlags(uint32_t ssl_flags) = 0;
     virtual KMError connect(const std::string& ws_url) = 0;
     virtual int send(const iovec* iovs, int count) = 0;
+    virtual int send(const KMBuffer &buf) = 0;
     virtual KMError close() = 0;
     virtual bool canSendData() const = 0;
+    virtual KMError setSendBufferWatermarks(size_t high, size_t low) { return KMError::NOT_SUPPORTED; }
+    virtual KMError setCorkEnabled(bool enabled) { return KMError::NOT_SUPPORTED; }
+    virtual KMError setZeroCopyThreshold(size_t threshold) { return KMError::NOT_SUPPORTED; }
     virtual const std::string& getPath() const = 0;
     virtual const HttpHeader& getHeaders() const = 0;
     
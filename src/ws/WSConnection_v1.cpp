@@ -171,6 +171,11 @@ int WSConnection_V1::send(const iovec* iovs, int count)
     return ret;
 }
 
+int WSConnection_V1::send(const KMBuffer &buf)
+{
+    return stream_->sendData(buf);
+}
+
 KMError WSConnection_V1::close()
 {
     cleanup();
@@ -216,8 +221,8 @@ void WSConnection_V1::handleUpgradeRequest()
     auto const &req_header = stream_->getIncomingHeaders();
     origin_ = req_header.getHeader("Origin");
     do {
-        if (!kev::is_equal(req_header.getHeader("Upgrade"), "WebSocket") ||
-            !kev::contains_token(req_header.getHeader("Connection"), "Upgrade", ',')) {
+        if (!kev::is_equal(req_header.getHeader(keyUpgrade), "WebSocket") ||
+            !kev::contains_token(req_header.getHeader(keyConnection), "Upgrade", ',')) {
             KM_ERRXTRACE("handleRequest, not WebSocket request");
             err = KMError::PROTO_ERROR;
             break;
@@ -270,8 +275,8 @@ void WSConnection_V1::handleUpgradeResponse()
     int status_code = stream_->getStatusCode();
     auto const &rsp_header = stream_->getIncomingHeaders();
     if (status_code != 101 ||
-        !kev::is_equal(rsp_header.getHeader("Upgrade"), "WebSocket") ||
-        !kev::contains_token(rsp_header.getHeader("Connection"), "Upgrade", ',')) {
+        !kev::is_equal(rsp_header.getHeader(keyUpgrade), "WebSocket") ||
+        !kev::contains_token(rsp_header.getHeader(keyConnection), "Upgrade", ',')) {
         KM_ERRXTRACE("handleUpgradeResponse, invalid status code: "<<status_code);
         err = KMError::PROTO_ERROR;
     }
@@ -50,8 +50,21 @@ public:
                          const KMBuffer *init_buf,
                          HandshakeCallback cb);
     int send(const iovec* iovs, int count) override;
+    int send(const KMBuffer &buf) override;
     KMError close() override;
     bool canSendData() const override;
+    KMError setSendBufferWatermarks(size_t high, size_t low) override
+    {
+        return stream_->setSendBufferWatermarks(high, low);
+    }
+    KMError setCorkEnabled(bool enabled) override
+    {
+        return stream_->setCorkEnabled(enabled);
+    }
+    KMError setZeroCopyThreshold(size_t threshold) override
+    {
+        return stream_->setZeroCopyThreshold(threshold);
+    }
     const std::string& getPath() const override
     {
         return stream_->getPath();
@@ -162,6 +162,11 @@ int WSConnection_V2::send(const iovec* iovs, int count)
     return ret;
 }
 
+int WSConnection_V2::send(const KMBuffer &buf)
+{
+    return stream_->sendData(buf);
+}
+
 KMError WSConnection_V2::close()
 {
     stream_->close();
@@ -47,6 +47,7 @@ public:
     KMError connect(const std::string& ws_url) override;
     KMError attachStream(uint32_t stream_id, const H2ConnectionPtr& conn, HandshakeCallback cb);
     int send(const iovec* iovs, int count) override;
+    int send(const KMBuffer &buf) override;
     KMError close() override;
     bool canSendData() const override;
     
@@ -40,7 +40,24 @@ void WSHandler::cleanup()
 
 WSError WSHandler::handleData(uint8_t* data, size_t len)
 {
-    return decodeFrame(data, len);
+    KMBuffer buf(data, len, len);
+    return decodeFrame(buf);
+}
+
+WSError WSHandler::handleData(KMBuffer &buf)
+{
+    WSError err = WSError::NOERR;
+    for (auto it = buf.begin(); it != buf.end(); ++it) {
+        if (it->length() > 0) {
+            DESTROY_DETECTOR_SETUP();
+            err = decodeFrame(*it);
+            DESTROY_DETECTOR_CHECK(WSError::DESTROYED);
+            if (err != WSError::NOERR && err != WSError::NEED_MORE_DATA) {
+                break;
+            }
+        }
+    }
+    return err;
 }
 
 int WSHandler::encodeFrameHeader(FrameHeader hdr, uint8_t hdr_buf[WS_MAX_HEADER_SIZE])
@@ -105,10 +122,12 @@ int WSHandler::encodeFrameHeader(FrameHeader hdr, uint8_t hdr_buf[WS_MAX_HEADER_
     return hdr_len;
 }
 
-WSError WSHandler::decodeFrame(uint8_t* data, size_t len)
+WSError WSHandler::decodeFrame(const KMBuffer &buf)
 {
 #define WS_MAX_FRAME_DATA_LENGTH	10*1024*1024
     
+    auto *data = static_cast<uint8_t*>(buf.readPtr());
+    auto len = buf.length();
     size_t pos = 0;
     uint8_t b = 0;
     while(pos < len)
@@ -141,7 +160,8 @@ WSError WSHandler::decodeFrame(uint8_t* data, size_t len)
                     ctx_.hdr.plen = b & 0x7F;
                     ctx_.hdr.xpl.xpl64 = 0;
                     ctx_.pos = 0;
-                    ctx_.buf.clear();
+                    ctx_.payload.reset();
+                    ctx_.payload_len = 0;
                     if (isControlFrame(ctx_.hdr.opcode) && ctx_.hdr.plen > 125) {
                         // the payload length of control frames MUST <= 125
                         ctx_.state = DecodeState::IN_ERROR;
@@ -227,38 +247,33 @@ WSError WSHandler::decodeFrame(uint8_t* data, size_t len)
                     ctx_.state = DecodeState::IN_ERROR;
                     return WSError::PROTOCOL_ERROR;
                 }
-                ctx_.buf.clear();
+                ctx_.payload.reset();
+                ctx_.payload_len = 0;
                 ctx_.state = DecodeState::DATA;
                 
                 FALLTHROUGH;
             }
             case DecodeState::DATA:
             {
-                if (len-pos+ctx_.buf.size() < ctx_.hdr.length) {
-                    auto buf_size = ctx_.buf.size();
-                    auto read_len = len - pos;
-                    ctx_.buf.reserve(buf_size + read_len);
-                    ctx_.buf.insert(ctx_.buf.end(), data + pos, data + len);
+                if (len-pos+ctx_.payload_len < ctx_.hdr.length) {
+                    ctx_.appendPayload(buf.subbuffer(pos, len - pos));
                     return WSError::NEED_MORE_DATA;
                 }
 
-                uint8_t* notify_data = nullptr;
-                uint32_t notify_len = 0;
-                if (ctx_.buf.empty()) {
-                    notify_data = data + pos;
-                    notify_len = ctx_.hdr.length;
-                    pos += notify_len;
+                WSError err = WSError::NOERR;
+                if (!ctx_.payload) {
+                    KMBuffer payload;
+                    buf.sliceSelf(payload, pos, ctx_.hdr.length);
+                    pos += ctx_.hdr.length;
+                    handleDataMask(ctx_.hdr, payload);
+                    err = handleFrame(ctx_.hdr, payload);
                 } else {
-                    auto buf_size = ctx_.buf.size();
-                    auto read_len = ctx_.hdr.length - buf_size;
-                    ctx_.buf.reserve(ctx_.hdr.length);
-                    ctx_.buf.insert(ctx_.buf.end(), data + pos, data + pos + read_len);
-                    notify_data = &ctx_.buf[0];
-                    notify_len = ctx_.hdr.length;
+                    auto read_len = ctx_.hdr.length - ctx_.payload_len;
+                    ctx_.appendPayload(buf.subbuffer(pos, read_len));
                     pos += read_len;
+                    handleDataMask(ctx_.hdr, *ctx_.payload);
+                    err = handleFrame(ctx_.hdr, *ctx_.payload);
                 }
-                handleDataMask(ctx_.hdr, notify_data, notify_len);
-                auto err = handleFrame(ctx_.hdr, notify_data, notify_len);
                 if (err != WSError::NOERR) {
                     return err;
                 }
@@ -279,11 +294,10 @@ WSError WSHandler::decodeFrame(uint8_t* data, size_t len)
     return ctx_.state == DecodeState::HDR1 ? WSError::NOERR : WSError::NEED_MORE_DATA;
 }
 
-WSError WSHandler::handleFrame(const FrameHeader &hdr, void* payload, size_t len)
+WSError WSHandler::handleFrame(const FrameHeader &hdr, KMBuffer &payload)
 {
     DESTROY_DETECTOR_SETUP();
-    KMBuffer buf(payload, len, len);
-    if(frame_cb_) frame_cb_(hdr, buf);
+    if(frame_cb_) frame_cb_(hdr, payload);
     DESTROY_DETECTOR_CHECK(WSError::DESTROYED);
     return WSError::NOERR;
 }
@@ -25,7 +25,6 @@
 #include "wsdefs.h"
 #include "http/HttpParserImpl.h"
 #include "libkev/src/utils/DestroyDetector.h"
-#include <vector>
 
 WS_NS_BEGIN
 
@@ -41,6 +40,10 @@ public:
     WSMode getMode() const { return mode_; }
     
     WSError handleData(uint8_t* data, size_t len);
+    /* the payload of incoming frame refers to buf if buf owns shared data,
+     * the partial payload is retained instead of copied
+     */
+    WSError handleData(KMBuffer &buf);
     static int encodeFrameHeader(FrameHeader hdr, uint8_t hdr_buf[WS_MAX_HEADER_SIZE]);
     
     void setFrameCallback(FrameCallback cb) { frame_cb_ = std::move(cb); }
@@ -68,20 +71,34 @@ private:
         {
             memset(&hdr, 0, sizeof(hdr));
             state = DecodeState::HDR1;
-            buf.clear();
+            payload.reset();
+            payload_len = 0;
             pos = 0;
         }
+        void appendPayload(KMBuffer *buf)
+        {
+            if (!buf) {
+                return;
+            }
+            payload_len += buf->chainLength();
+            if (payload) {
+                payload->append(buf);
+            } else {
+                payload.reset(buf);
+            }
+        }
         FrameHeader hdr;
         DecodeState state{ DecodeState::HDR1 };
-        std::vector<uint8_t> buf;
+        KMBuffer::Ptr payload;
+        size_t payload_len = 0;
         uint8_t pos = 0;
     } DecodeContext;
     void cleanup();
     
     void handleDataMask(const FrameHeader& hdr, uint8_t* data, size_t len);
     void handleDataMask(const FrameHeader& hdr, KMBuffer &buf);
-    WSError decodeFrame(uint8_t* data, size_t len);
-    WSError handleFrame(const FrameHeader &hdr, void* payload, size_t len);
+    WSError decodeFrame(const KMBuffer &buf);
+    WSError handleFrame(const FrameHeader &hdr, KMBuffer &payload);
     
 private:
     WSMode                  mode_ = WSMode::CLIENT;
@@ -87,6 +87,20 @@ KMError WebSocket::Impl::setSslFlags(uint32_t ssl_flags)
     return ws_conn_->setSslFlags(ssl_flags);
 }
 
+KMError WebSocket::Impl::setSendBufferWatermarks(size_t high, size_t low)
+{
+    return ws_conn_->setSendBufferWatermarks(high, low);
+}
+
+KMError WebSocket::Impl::setZeroCopyThreshold(size_t threshold)
+{
+    auto ret = ws_conn_->setZeroCopyThreshold(threshold);
+    if (ret == KMError::NOERR) {
+        zero_copy_threshold_ = threshold;
+    }
+    return ret;
+}
+
 KMError WebSocket::Impl::setProxyInfo(const ProxyInfo &proxy_info)
 {
     return ws_conn_->setProxyInfo(proxy_info);
@@ -226,10 +240,10 @@ void WebSocket::Impl::onWsData(KMBuffer &buf)
 {
     if (getState() == State::OPEN) {
         for (auto it = buf.begin(); it != buf.end(); ++it) {
-            auto *data = static_cast<uint8_t*>(it->readPtr());
-            auto len = it->length();
+            KMBuffer data;
+            it->sliceSelf(data, 0, it->length());
             DESTROY_DETECTOR_SETUP();
-            WSError err = ws_handler_.handleData(data, len);
+            WSError err = ws_handler_.handleData(data);
             DESTROY_DETECTOR_CHECK_VOID();
             if(getState() == State::IN_ERROR || getState() == State::CLOSED) {
                 return ;
@@ -414,24 +428,22 @@ KMError WebSocket::Impl::sendWsFrame(ws::FrameHeader hdr, const KMBuffer &buf)
         WSHandler::handleDataMask(hdr.maskey, const_cast<KMBuffer&>(buf));
     }
     hdr.length = uint32_t(plen);
-    hdr_len = ws_handler_.encodeFrameHeader(hdr, hdr_buf);
-    
-    iovec iovs[129];
-    int count = 0;
-    iovs[count].iov_base = (char*)hdr_buf;
-    iovs[count++].iov_len = hdr_len;
-    for (auto it = buf.begin(); it != buf.end(); ++it) {
-        if (it->length() > 0) {
-            if (count < 129) {
-                iovs[count].iov_base = static_cast<char*>(it->readPtr());
-                iovs[count++].iov_len = static_cast<decltype(iovs[0].iov_len)>(it->length());
-            } else {
-                return KMError::BUFFER_TOO_LONG;
-            }
-        }
+    KMBuffer hdr_kmb;
+    if (zero_copy_threshold_ > 0 && plen >= zero_copy_threshold_) {
+        // the header is held with the payload until the zero copy send is completed
+        hdr_kmb.allocBuffer(WS_MAX_HEADER_SIZE);
+        hdr_len = ws_handler_.encodeFrameHeader(hdr, static_cast<uint8_t*>(hdr_kmb.writePtr()));
+        hdr_kmb.bytesWritten(hdr_len);
+    } else {
+        hdr_len = ws_handler_.encodeFrameHeader(hdr, hdr_buf);
+        hdr_kmb.reset(hdr_buf, hdr_len, hdr_len);
     }
-    
-    auto ret = ws_conn_->send(iovs, count);
+    if (plen > 0) {
+        // temporary link to hdr_kmb, the payload is sent without copying
+        hdr_kmb.append(const_cast<KMBuffer*>(&buf));
+    }
+    auto ret = ws_conn_->send(hdr_kmb);
+    hdr_kmb.unlink();
     return ret < 0 ? KMError::SOCK_ERROR : KMError::NOERR;
 }
 
@@ -70,6 +70,9 @@ public:
     }
     
     KMError setSslFlags(uint32_t ssl_flags);
+    KMError setSendBufferWatermarks(size_t high, size_t low);
+    KMError setCorkEnabled(bool enabled) { return ws_conn_->setCorkEnabled(enabled); }
+    KMError setZeroCopyThreshold(size_t threshold);
     KMError connect(const std::string& ws_url);
     KMError attachFd(SOCKET_FD fd, const KMBuffer *init_buf, HandshakeCallback cb);
     KMError attachSocket(TcpSocket::Impl&& tcp, HttpParser::Impl&& parser, const KMBuffer *init_buf, HandshakeCallback cb);
@@ -139,6 +142,7 @@ private:
     State                   state_ = State::IDLE;
     ws::WSHandler           ws_handler_;
     bool                    fragmented_ = false;
+    size_t                  zero_copy_threshold_ = 0;
     
     size_t                  body_bytes_sent_ = 0;
     
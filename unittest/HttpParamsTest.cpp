@@ -0,0 +1,82 @@
+
+#include <gtest/gtest.h>
+#include "http/HttpParams.h"
+
+#include <string>
+
+using namespace kuma;
+
+namespace {
+    /* parse body in two pieces split at offset */
+    KMError parseSplit(const std::string &body, size_t split, HttpParams &params,
+                       size_t max_bytes = 64 * 1024, size_t max_fields = 100)
+    {
+        FormUrlEncodedParser parser(max_bytes, max_fields);
+        auto ret = parser.parse(body.data(), split, params);
+        if (ret != KMError::NOERR) {
+            return ret;
+        }
+        ret = parser.parse(body.data() + split, body.size() - split, params);
+        if (ret != KMError::NOERR) {
+            return ret;
+        }
+        return parser.finish(params);
+    }
+}
+
+TEST(HttpParamsTest, Form_Split_Everywhere)
+{
+    const std::string body = "name=J%6Fhn+Doe&Q=a%3db&empty=&noval&last=%41";
+    for (size_t split = 0; split <= body.size(); ++split) {
+        HttpParams params;
+        ASSERT_EQ(KMError::NOERR, parseSplit(body, split, params)) << "split=" << split;
+        EXPECT_EQ("John Doe", params.get("name")) << "split=" << split;
+        EXPECT_EQ("a=b", params.get("q")) << "split=" << split;
+        EXPECT_EQ("", params.get("empty"));
+        EXPECT_EQ("", params.get("noval"));
+        EXPECT_EQ("A", params.get("last")) << "split=" << split;
+        EXPECT_EQ(5, params.size());
+    }
+}
+
+TEST(HttpParamsTest, Form_Split_Percent)
+{
+    // split as "%4|1", "%|41" and "|%41"
+    const std::string body = "a=%41";
+    for (size_t split = 2; split <= body.size(); ++split) {
+        HttpParams params;
+        ASSERT_EQ(KMError::NOERR, parseSplit(body, split, params));
+        EXPECT_EQ("A", params.get("a")) << "split=" << split;
+    }
+}
+
+TEST(HttpParamsTest, Form_Invalid_Percent)
+{
+    // the incomplete or invalid escapes are kept literally, even at the end of body
+    const std::string body = "x=%zz%4&y=%";
+    for (size_t split = 0; split <= body.size(); ++split) {
+        HttpParams params;
+        ASSERT_EQ(KMError::NOERR, parseSplit(body, split, params));
+        EXPECT_EQ("%zz%4", params.get("x")) << "split=" << split;
+        EXPECT_EQ("%", params.get("y")) << "split=" << split;
+    }
+}
+
+TEST(HttpParamsTest, Form_Limits)
+{
+    HttpParams params;
+    EXPECT_NE(KMError::NOERR, parseSplit("a=1&b=2&c=3", 5, params, 64 * 1024, 2));
+    params.clear();
+    EXPECT_NE(KMError::NOERR, parseSplit("a=12345678", 5, params, 8));
+}
+
+TEST(HttpParamsTest, Query_Lookup)
+{
+    HttpParams params;
+    params.parseQuery("b=2&A=1&b=3&c=");
+    EXPECT_EQ("1", params.get("a"));
+    EXPECT_EQ("3", params.get("B"));
+    EXPECT_EQ("", params.get("c"));
+    EXPECT_EQ("", params.get("d"));
+    EXPECT_EQ(3, params.size());
+}
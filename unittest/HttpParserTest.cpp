@@ -0,0 +1,228 @@
+
+#include <gtest/gtest.h>
+#include "kmapi.h"
+
+#include <string>
+#include <vector>
+
+using namespace kuma;
+
+namespace {
+    struct ParseResult
+    {
+        bool complete = false;
+        bool error = false;
+        std::string body;
+    };
+
+    /* feed msg to parser in the pieces split at the offsets */
+    ParseResult parseSplit(HttpParser &parser, const std::string &msg, const std::vector<size_t> &splits)
+    {
+        ParseResult result;
+        parser.setDataCallback([&result] (KMBuffer &buf) {
+            auto len = buf.chainLength();
+            std::string str(len, '\0');
+            buf.readChained(&str[0], len);
+            result.body += str;
+        });
+        parser.setEventCallback([&result] (HttpEvent ev) {
+            if (ev == HttpEvent::COMPLETE) {
+                result.complete = true;
+            } else if (ev == HttpEvent::HTTP_ERROR) {
+                result.error = true;
+            }
+        });
+        size_t offset = 0;
+        for (size_t i = 0; i <= splits.size() && !result.error; ++i) {
+            auto next = i < splits.size() ? splits[i] : msg.size();
+            parser.parse(msg.data() + offset, next - offset);
+            offset = next;
+        }
+        return result;
+    }
+
+    ParseResult parseSplit(HttpParser &parser, const std::string &msg, size_t split)
+    {
+        return parseSplit(parser, msg, std::vector<size_t>{ split });
+    }
+}
+
+TEST(HttpParserTest, Split_CRLF)
+{
+    const std::string value(40, 'v');
+    const std::string msg = "GET /a?b=1 HTTP/1.1\r\nHost: example.com\r\nX-Long: " + value + "\r\n\r\n";
+    for (size_t split = 1; split < msg.size(); ++split) {
+        HttpParser parser;
+        auto result = parseSplit(parser, msg, split);
+        ASSERT_TRUE(result.complete) << "split=" << split;
+        EXPECT_FALSE(result.error);
+        EXPECT_STREQ("GET", parser.getMethod());
+        EXPECT_STREQ("/a", parser.getUrlPath());
+        EXPECT_STREQ("example.com", parser.getHeaderValue("Host"));
+        EXPECT_STREQ(value.c_str(), parser.getHeaderValue("X-Long"));
+    }
+}
+
+TEST(HttpParserTest, Split_Bare_LF)
+{
+    const std::string msg = "HTTP/1.1 200 OK\nContent-Length: 3\n\nabc";
+    for (size_t split = 1; split < msg.size(); ++split) {
+        HttpParser parser;
+        auto result = parseSplit(parser, msg, split);
+        ASSERT_TRUE(result.complete) << "split=" << split;
+        EXPECT_EQ(200, parser.getStatusCode());
+        EXPECT_EQ("abc", result.body);
+    }
+}
+
+TEST(HttpParserTest, Url_Decode)
+{
+    struct {
+        const char *url;
+        const char *path;
+        const char *query;
+    } cases[] = {
+        { "/a%20b+c?x=%41&y=1+2", "/a b c", "x=A&y=1 2" },
+        { "/plain/path/longer/than/thirty/two/bytes?q=1", "/plain/path/longer/than/thirty/two/bytes", "q=1" },
+        // the invalid escapes are kept as they are
+        { "/bad%zz%4", "/bad%zz%4", "" },
+    };
+    for (auto &c : cases) {
+        HttpParser parser;
+        auto msg = std::string("GET ") + c.url + " HTTP/1.1\r\n\r\n";
+        auto result = parseSplit(parser, msg, msg.size() / 2);
+        ASSERT_TRUE(result.complete) << c.url;
+        EXPECT_STREQ(c.path, parser.getUrlPath());
+        EXPECT_STREQ(c.query, parser.getUrlQuery());
+    }
+}
+
+TEST(HttpParserTest, Chunked_Split_Everywhere)
+{
+    const std::string msg = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "1A;ext=1\r\nabcdefghijklmnopqrstuvwxyz\r\n"
+        "5\r\n01234\r\n"
+        "0;last\r\nX-Trailer: 1\r\n\r\n";
+    const std::string body = "abcdefghijklmnopqrstuvwxyz01234";
+    for (size_t split = 1; split < msg.size(); ++split) {
+        HttpParser parser;
+        auto result = parseSplit(parser, msg, split);
+        ASSERT_TRUE(result.complete) << "split=" << split;
+        EXPECT_FALSE(result.error);
+        EXPECT_EQ(body, result.body) << "split=" << split;
+    }
+    
+    // one byte each time
+    std::vector<size_t> splits;
+    for (size_t i = 1; i < msg.size(); ++i) {
+        splits.push_back(i);
+    }
+    HttpParser parser;
+    auto result = parseSplit(parser, msg, splits);
+    ASSERT_TRUE(result.complete);
+    EXPECT_EQ(body, result.body);
+}
+
+TEST(HttpParserTest, Chunk_Size_Line)
+{
+    struct {
+        const char *chunks;
+        bool ok;
+    } cases[] = {
+        { "a\r\n0123456789\r\n0\r\n\r\n", true },
+        { "A\r\n0123456789\r\n0\r\n\r\n", true },
+        { "01\r\na\r\n0\r\n\r\n", true },
+        { "1 ;e\r\na\r\n0\r\n\r\n", true },
+        { "1;a=\"x;y\"\r\na\r\n0\r\n\r\n", true },
+        { "zz\r\n", false },
+        { "\r\n", false },
+        { "-1\r\n", false },
+        // more hex digits than size_t holds
+        { "FFFFFFFFFFFFFFFFF\r\n", false },
+        // the data is longer than the chunk size
+        { "1\r\nab\r\n0\r\n\r\n", false },
+    };
+    const std::string header = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    for (auto &c : cases) {
+        const std::string msg = header + c.chunks;
+        for (size_t split = header.size(); split < msg.size(); ++split) {
+            HttpParser parser;
+            auto result = parseSplit(parser, msg, split);
+            EXPECT_EQ(c.ok, result.complete) << "case=" << c.chunks << ", split=" << split;
+            EXPECT_EQ(!c.ok, result.error) << "case=" << c.chunks << ", split=" << split;
+        }
+    }
+}
+
+TEST(HttpParserTest, Limits_Start_Line)
+{
+    HttpParser::Limits limits;
+    limits.max_start_line = 64;
+    const std::string msg = "GET /" + std::string(100, 'a') + " HTTP/1.1\r\n\r\n";
+    for (size_t split : { size_t(70), msg.size() - 1 }) {
+        HttpParser parser;
+        parser.setLimits(limits);
+        auto result = parseSplit(parser, msg, split);
+        EXPECT_TRUE(result.error) << "split=" << split;
+        EXPECT_EQ(400, parser.getErrorStatus());
+    }
+    {   // rejected before the line end arrives
+        HttpParser parser;
+        parser.setLimits(limits);
+        auto result = parseSplit(parser, msg.substr(0, 70), 35);
+        EXPECT_TRUE(result.error);
+    }
+    
+    limits.max_start_line = 1024;
+    HttpParser parser;
+    parser.setLimits(limits);
+    auto result = parseSplit(parser, msg, 70);
+    EXPECT_TRUE(result.complete);
+    EXPECT_EQ(0, parser.getErrorStatus());
+}
+
+TEST(HttpParserTest, Limits_Header_Count)
+{
+    HttpParser::Limits limits;
+    limits.max_header_count = 10;
+    for (int count : { 10, 11 }) {
+        std::string msg = "GET / HTTP/1.1\r\n";
+        for (int i = 0; i < count; ++i) {
+            msg += "H" + std::to_string(i) + ": v\r\n";
+        }
+        msg += "\r\n";
+        HttpParser parser;
+        parser.setLimits(limits);
+        auto result = parseSplit(parser, msg, msg.size() / 2);
+        EXPECT_EQ(count <= 10, result.complete) << "count=" << count;
+        EXPECT_EQ(count <= 10 ? 0 : 431, parser.getErrorStatus()) << "count=" << count;
+    }
+}
+
+TEST(HttpParserTest, Limits_Header_Bytes)
+{
+    HttpParser::Limits limits;
+    limits.max_header_bytes = 1024;
+    const std::string msg = "GET / HTTP/1.1\r\nX-Big: " + std::string(2000, 'b') + "\r\n\r\n";
+    HttpParser parser;
+    parser.setLimits(limits);
+    // rejected before the line end arrives
+    auto result = parseSplit(parser, msg.substr(0, 1100), 600);
+    EXPECT_TRUE(result.error);
+    EXPECT_EQ(431, parser.getErrorStatus());
+}
+
+TEST(HttpParserTest, Limits_Chunk_Extension)
+{
+    HttpParser::Limits limits;
+    limits.max_chunk_extension = 16;
+    const std::string header = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    for (size_t ext_len : { size_t(8), size_t(100) }) {
+        const std::string msg = header + "1;" + std::string(ext_len, 'e') + "\r\na\r\n0\r\n\r\n";
+        HttpParser parser;
+        parser.setLimits(limits);
+        auto result = parseSplit(parser, msg, header.size() + 4);
+        EXPECT_EQ(ext_len < 16, result.complete) << "ext_len=" << ext_len;
+        EXPECT_EQ(ext_len < 16 ? 0 : 400, parser.getErrorStatus()) << "ext_len=" << ext_len;
+    }
+}
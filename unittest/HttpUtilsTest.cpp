@@ -0,0 +1,124 @@
+
+#include <gtest/gtest.h>
+#include "http/httputils.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace kuma;
+
+namespace {
+    // around the block sizes of SSE2 and AVX2 scanning
+    const size_t kTestLengths[] = { 15, 16, 31, 32, 33 };
+}
+
+TEST(HttpUtilsTest, findLineEnd_Position)
+{
+    for (auto len : kTestLengths) {
+        std::string str(len, 'a');
+        const char *colon = str.data();
+        EXPECT_EQ(str.data() + len, findLineEnd(str.data(), str.data() + len, &colon));
+        EXPECT_EQ(nullptr, colon);
+        for (size_t pos = 0; pos < len; ++pos) {
+            str.assign(len, 'a');
+            str[pos] = '\n';
+            auto *begin = str.data();
+            EXPECT_EQ(begin + pos, findLineEnd(begin, begin + len)) << "len=" << len << ", pos=" << pos;
+        }
+    }
+}
+
+TEST(HttpUtilsTest, findLineEnd_Colon)
+{
+    for (auto len : kTestLengths) {
+        for (size_t pos = 0; pos + 1 < len; ++pos) {
+            // the colon is in an earlier block than LF
+            std::string str(len, 'a');
+            str[pos] = ':';
+            str[len - 1] = '\n';
+            auto *begin = str.data();
+            const char *colon = nullptr;
+            EXPECT_EQ(begin + len - 1, findLineEnd(begin, begin + len, &colon));
+            EXPECT_EQ(begin + pos, colon) << "len=" << len << ", pos=" << pos;
+
+            // the colon after LF is not in this line
+            str.assign(len, 'a');
+            str[pos] = '\n';
+            str[pos + 1] = ':';
+            begin = str.data();
+            EXPECT_EQ(begin + pos, findLineEnd(begin, begin + len, &colon));
+            EXPECT_EQ(nullptr, colon) << "len=" << len << ", pos=" << pos;
+        }
+    }
+}
+
+TEST(HttpUtilsTest, findLineEnd_FirstColon)
+{
+    std::string str = "Host: example.com:8080\r\n";
+    const char *colon = nullptr;
+    auto *p = findLineEnd(str.data(), str.data() + str.size(), &colon);
+    EXPECT_EQ(str.data() + str.size() - 1, p);
+    EXPECT_EQ(str.data() + 4, colon);
+}
+
+TEST(HttpUtilsTest, findUrlSpecial_Position)
+{
+    const char specials[] = { '%', '+', ' ', '\t', '\0', 0x7F };
+    for (auto len : kTestLengths) {
+        std::string str(len, 'a');
+        EXPECT_EQ(str.data() + len, findUrlSpecial(str.data(), str.data() + len));
+        for (auto c : specials) {
+            for (size_t pos = 0; pos < len; ++pos) {
+                str.assign(len, 'a');
+                str[pos] = c;
+                auto *begin = str.data();
+                EXPECT_EQ(begin + pos, findUrlSpecial(begin, begin + len))
+                    << "len=" << len << ", pos=" << pos << ", c=" << int(c);
+            }
+        }
+    }
+}
+
+TEST(HttpUtilsTest, findUrlSpecial_HighBytes)
+{
+    // the bytes above 0x7F are not control characters in unsigned compare
+    for (auto len : kTestLengths) {
+        std::string str(len, '\xE4');
+        EXPECT_EQ(str.data() + len, findUrlSpecial(str.data(), str.data() + len));
+        str[len - 1] = '%';
+        EXPECT_EQ(str.data() + len - 1, findUrlSpecial(str.data(), str.data() + len));
+    }
+}
+
+TEST(HttpUtilsTest, findEither_Position)
+{
+    for (auto len : kTestLengths) {
+        std::string str(len, 'a');
+        EXPECT_EQ(str.data() + len, findEither(str.data(), str.data() + len, '&', '='));
+        for (size_t pos = 0; pos < len; ++pos) {
+            for (auto c : { '&', '=' }) {
+                str.assign(len, 'a');
+                str[pos] = c;
+                if (pos + 1 < len) {
+                    // only the first one is found
+                    str[len - 1] = c == '&' ? '=' : '&';
+                }
+                auto *begin = str.data();
+                EXPECT_EQ(begin + pos, findEither(begin, begin + len, '&', '='))
+                    << "len=" << len << ", pos=" << pos << ", c=" << c;
+            }
+        }
+    }
+}
+
+TEST(HttpUtilsTest, formatChunkSizeLine)
+{
+    char buf[kMaxChunkSizeLineLength];
+    auto len = formatChunkSizeLine(0, buf);
+    EXPECT_EQ("0\r\n", std::string(buf, len));
+    len = formatChunkSizeLine(0x1a2b, buf);
+    EXPECT_EQ("1a2b\r\n", std::string(buf, len));
+    len = formatChunkSizeLine(SIZE_MAX, buf);
+    EXPECT_EQ(kMaxChunkSizeLineLength, len);
+    EXPECT_EQ(std::string(sizeof(size_t) * 2, 'f') + "\r\n", std::string(buf, len));
+}
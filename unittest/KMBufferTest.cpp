@@ -1,5 +1,6 @@
 
 #include <gtest/gtest.h>
+#include <thread>
 #include "kmbuffer.h"
 
 using namespace kuma;
@@ -271,3 +272,55 @@ TEST(KMBufferTest, Test_Unlink)
     EXPECT_FALSE(buf3.isChained());
     EXPECT_EQ(256, buf3.length());
 }
+
+TEST(KMBufferTest, Test_Slice_Self)
+{
+    KMBuffer buf(4096);
+    memset(buf.writePtr(), 'A', 1024);
+    buf.bytesWritten(1024);
+    
+    KMBuffer slice;
+    buf.sliceSelf(slice, 100, 200);
+    EXPECT_EQ(200, slice.length());
+    EXPECT_EQ(static_cast<char*>(buf.readPtr()) + 100, slice.readPtr());
+    
+    // slice shares the storage and keeps it alive
+    buf.reset();
+    EXPECT_EQ('A', *static_cast<char*>(slice.readPtr()));
+    
+    char str[256] = {0};
+    KMBuffer buf2(str, sizeof(str), sizeof(str));
+    buf2.sliceSelf(slice, 200, 100);
+    EXPECT_EQ(56, slice.length());
+    EXPECT_EQ(str + 200, slice.readPtr());
+}
+
+TEST(KMBufferTest, Test_Buffer_Pool)
+{
+    auto &pool = KMBufferPool::threadPool();
+    pool.trim();
+    auto stats = pool.getStats();
+    {
+        KMBuffer buf(4000);
+        EXPECT_EQ(4000, buf.space());
+    }
+    {
+        KMBuffer buf(4000);
+        EXPECT_EQ(4000, buf.space());
+    }
+    auto stats2 = pool.getStats();
+    EXPECT_EQ(stats.misses + 1, stats2.misses);
+    EXPECT_EQ(stats.hits + 1, stats2.hits);
+    EXPECT_LT(0, stats2.bytes_held);
+
+    auto *buf = new KMBuffer(4000);
+    std::thread thr([buf] { delete buf; });
+    thr.join();
+    KMBuffer buf2(4000);
+    auto stats3 = pool.getStats();
+    EXPECT_EQ(stats2.remote_frees + 1, stats3.remote_frees);
+    EXPECT_EQ(stats2.hits + 2, stats3.hits);
+
+    pool.trim();
+    EXPECT_EQ(0, pool.getStats().bytes_held);
+}